@@ -3,8 +3,12 @@
 
    Hackerspace project to read pulses from an old telephone pulse dialer and output as
    keyboard characters -- requires a Teensy to do that, or else defaults to serial port
-   RS-232 at 9600 baud (N81).  When compiling for Teensy, be sure to select
-   "USB Keyboard" from the Tools>USB Type menu in the Arduino IDE.
+   at 115200 baud (N81) carrying framed binary records (see glf_telemetry.h), or RS-232 ASCII
+   at 9600 baud (N81) with PULSEDIAL_TELEMETRY set to 0 below.  When compiling for Teensy,
+   be sure to select "USB Keyboard" from the Tools>USB Type menu in the Arduino IDE -- or
+   select "Raw HID" to get timestamped digit reports instead of keystrokes (see rawhid_service()).
+   The ATtiny85 has no UART -- there the same serial output goes out on PB1 at 57600 baud through
+   the interrupt-driven glf_softuart, which leaves the scheduler's debounce ticks alone.
 
    Design works with Arduino, Attiny85, or Teensy using custom circuit appropriate to
    defined pins -- one pin for "dialing" switch (normally off), one pin for "pulse" switch
@@ -21,25 +25,88 @@
 #include "wiring_private.h"
 #include "pins_arduino.h"
 
+#include <avr/eeprom.h>
+
 #include "glf_scheduler.h"
+#include "glf_fsm.h"
+#include "glf_telemetry.h"
+#include "glf_softuart.h"     /* ATtiny85 only */
+
+/* Compile-time defaults -- the pins, timeouts and debounce thresholds actually used come from the
+   configuration block in EEPROM when it holds a valid one (see config_load()). */
 
 #ifdef CORE_TEENSY
 /* Assume Teensy 2.0 */
-int led_dialing_pin      =  11;   /* LED to glow during lockput periods */
-int now_dialing_in_pin   =  2;
-int dial_pulse_in_pin    =  6;
+#define PULSEDIAL_LED_PIN      11   /* LED to glow during lockput periods */
+#define PULSEDIAL_DIALING_PIN   2
+#define PULSEDIAL_PULSE_PIN     6
+
+#elif defined(__ATtinyX5__)
+/* Assume ATtiny85 -- PB1 is taken by glf_softuart for serial output */
+#define PULSEDIAL_LED_PIN       0   /* LED to glow during lockput periods */
+#define PULSEDIAL_DIALING_PIN   3
+#define PULSEDIAL_PULSE_PIN     4
 
 #else
 /* Assume Arduino */
-int led_dialing_pin      =  13;   /* LED to glow during lockput periods */
-int now_dialing_in_pin   =  7;    /* From original IR-D15A "LEFT" output */
-int dial_pulse_in_pin    =  6;    /* From original IR-D15A "RIGHT" output */
+#define PULSEDIAL_LED_PIN      13   /* LED to glow during lockput periods */
+#define PULSEDIAL_DIALING_PIN   7   /* From original IR-D15A "LEFT" output */
+#define PULSEDIAL_PULSE_PIN     6   /* From original IR-D15A "RIGHT" output */
 #endif
 
-/* Either Arduino or Teensy */
+/* Pins in use -- the defaults above until config_load() or the shell moves them */
+int led_dialing_pin      =  PULSEDIAL_LED_PIN;
+int now_dialing_in_pin   =  PULSEDIAL_DIALING_PIN;
+int dial_pulse_in_pin    =  PULSEDIAL_PULSE_PIN;
+
+/* Arduino, ATtiny85 or Teensy */
 
 #include <Serial.h>
 
+#ifdef CORE_TEENSY
+#ifdef USB_RAWHID
+/* Tools>USB Type is "Raw HID" -- send digits as timestamped events in 64 byte reports */
+#define PULSEDIAL_RAWHID 1
+#else
+/* Keyboard output -- 1 to pack queued keystrokes into back-to-back reports (n+1 reports for n
+   keys), 0 for the original Keyboard.print() per digit (press and release report for each). */
+#define PULSEDIAL_KBD_BATCH 1
+
+/* 1 to look dialed digits and digit sequences up in macro_table below, typing shortcuts and text
+   instead of the digits themselves -- needs PULSEDIAL_KBD_BATCH. */
+#define PULSEDIAL_MACROS 0
+#endif
+#endif
+
+#if !defined(__ATtinyX5__)
+/* 1 for the configuration command shell on the serial port (see shell_exec()) */
+#define PULSEDIAL_SHELL 1
+#endif
+
+#ifndef CORE_TEENSY
+/* Serial output -- 1 for framed binary telemetry records at 115200 baud, which also carry dial
+   and scheduler statistics; 0 for the original single ASCII digit per dial at 9600 baud. */
+#define PULSEDIAL_TELEMETRY 1
+#endif
+
+#if !defined(__ATtinyX5__) && !defined(CORE_TEENSY)
+/* 1 to count dial pulses with Timer1 instead of sampling them -- wire the pulse contact to D5 (T1)
+   and "set pulse 5".  Edges closer than PULSEDIAL_HW_HOLDOFF ms after a counted pulse are taken as
+   contact bounce (the dial's make is 40 ms). */
+#define PULSEDIAL_HWCOUNT     0
+#define PULSEDIAL_HW_HOLDOFF 20
+#endif
+
+/* The off-normal switch sits still between numbers -- after PULSEDIAL_IDLE_MS stable it is only
+   peeked at each ms, with a full sample every PULSEDIAL_IDLE_SLOW ms, until it moves */
+#define PULSEDIAL_IDLE_MS    250
+#define PULSEDIAL_IDLE_SLOW   50
+
+#if defined(__ATtinyX5__)
+/* No UART -- serial output (transmit only) through glf_softuart at 57600 baud */
+#define PULSEDIAL_SOFTUART 1
+#endif
+
 
 unsigned char ok_left       = 1;
 unsigned char ok_right      = 1;
@@ -47,161 +114,1605 @@ unsigned char lockout_ended = 0;
 unsigned char left_lockout  = 0;
 unsigned char right_lockout = 0;
 
+telem_dial_stats dial_stats;      /* counted whatever the output -- only reported by telemetry */
 
-/* --------- The setup() method runs once, when the sketch starts ------------------- */
 
-void setup()
+/* Runtime configuration, kept in EEPROM.  Loaded at boot -- compile-time defaults if the block is
+   missing, from another version, damaged, or names pins that cannot be used -- and written back a
+   byte per pass of the event loop by config_service(), so saving never stalls the decoder on EEPROM
+   write times. */
+
+#define CONFIG_MAGIC    0xD1
+#define CONFIG_VERSION  1
+#define CONFIG_ADDR     0       /* EEPROM address of the block */
+
+typedef struct
 {
-  pinMode(led_dialing_pin, OUTPUT);
-  digitalWrite(led_dialing_pin,LOW);   /* LED off */
+  unsigned char magic;
+  unsigned char version;
+  unsigned char led_pin;
+  unsigned char dialing_pin;
+  unsigned char pulse_pin;
+  unsigned int dial_timeout_ms;   /* dial held this long (no pulses) ends the number */
+  unsigned int holdoff_ms;        /* startup wait before dialing is read */
+  char db_up;                     /* debounce thresholds -- see sched_set_debounce() */
+  char db_down;
+  char db_max;
+  unsigned char sum;              /* 8-bit sum of all the bytes above */
+}
+pulsedial_config;
 
-  pinMode(now_dialing_in_pin,  INPUT_PULLUP);
-  pinMode(dial_pulse_in_pin, INPUT_PULLUP);
+pulsedial_config config;
+unsigned char config_save_pos = 0xFF;   /* next byte to write back, 0xFF when not saving */
 
-  sched_list_init(0);             /* prepare an empty schedule list -- ignore analog pins */
-  sched_event(dial_pulse_in_pin,1,1);  /* set up a recurring 1 ms timer to debounce dial_pulse_in pin */
-  sched_event(now_dialing_in_pin,1,1);   /* set up a recurring 1 ms timer to debounce now_dialing_in pin */
 
-#ifdef CORE_TEENSY
-  /* set up to hold off for 10 seconds -- gives keyboard time to be recognized and enumerated */
-  sched_event(20,0,1000);        /* set up a nonrecurring 1 second timer -- identity 20 */
+#if SCHED_EDGE_TIMES
+/* Latency instrumentation -- where the time goes between the dial and the host.  For every digit the
+   time is split into stages, and each stage is counted into a histogram of power-of-2 ms buckets
+   (bucket 0 under 1 ms, bucket b from 2^(b-1) up to 2^b ms, the last bucket everything longer):
 
-  /* Serial.begin(9600); */  /* use keyboard instead -- no setup needed */
+      LAT_OFFNORMAL   last dial pulse confirmed, to first raw edge of the off-normal switch
+                      releasing -- the dial spinning home, purely mechanical
+      LAT_DEBOUNCE    first raw edge of off-normal release, to its debounced confirmation
+      LAT_LOOP        confirmation, to the decoder in loop() acting on it
+      LAT_OUTPUT      decoder, to hand-off to Keyboard / RawHID / Serial
+      LAT_TOTAL       last dial pulse confirmed, to hand-off
 
-  /* Wait until 10 second timer elapses */
-  while (!(sched_check(20)))
+   An 'L' on the serial port reports the histograms. */
+
+#define LAT_OFFNORMAL  0
+#define LAT_DEBOUNCE   1
+#define LAT_LOOP       2
+#define LAT_OUTPUT     3
+#define LAT_TOTAL      4
+#define LAT_STAGES     5
+
+unsigned int lat_hist[LAT_STAGES][TELEM_LAT_BUCKETS];
+unsigned long lat_pulse_st = 0;       /* last dial pulse confirmed, for the digit in flight */
+unsigned long lat_decode_st = 0;      /* decoder completion, for the digit in flight */
+unsigned char lat_pending = 0;        /* nonzero while a decoded digit awaits hand-off */
+unsigned char lat_report = LAT_STAGES;   /* next stage to report by telemetry, LAT_STAGES if none */
+
+
+void lat_add(unsigned char stage, unsigned long st)   /* st -- a difference of scheduler stamps */
+{
+  unsigned char b = 0;
+  unsigned long ms = SCHED_STAMP_MS(st);
+
+  while (ms && (b < (TELEM_LAT_BUCKETS - 1)))
     {
+      ms >>= 1;
+      b++;
     }
 
-#else
-  /* set up to hold off for 1 second */
-  sched_event(20,0,1000);        /* set up a nonrecurring 1 second timer -- identity 20 */
+  if (lat_hist[stage][b] < 0xFFFF)
+    {
+      lat_hist[stage][b]++;
+    }
+}
 
-  Serial.begin(9600);
-  Serial.println("GLF 2015/05/19 -- pulsedial_serial.ino -- Arduino");
 
-  /* Wait until 1 second timer elapses */
-  while (!(sched_check(20)))
+/* The decoder has just finished a digit -- pick up the edge times behind it */
+
+void lat_decoded(void)
+{
+  unsigned long raw;
+  unsigned long confirm;
+  unsigned long pulse_raw;
+
+  lat_decode_st = sched_stamp();
+
+  sched_pin_edge_times(now_dialing_in_pin, &raw, &confirm);
+  sched_pin_edge_times(dial_pulse_in_pin, &pulse_raw, &lat_pulse_st);
+
+  lat_add(LAT_OFFNORMAL, raw - lat_pulse_st);
+  lat_add(LAT_DEBOUNCE, confirm - raw);
+  lat_add(LAT_LOOP, lat_decode_st - confirm);
+
+  lat_pending = 1;
+}
+
+
+/* The digit has just been handed to the output */
+
+void lat_handoff(void)
+{
+  unsigned long st;
+
+  if (!lat_pending)
     {
+      return;
     }
 
+  st = sched_stamp();
+  lat_add(LAT_OUTPUT, st - lat_decode_st);
+  lat_add(LAT_TOTAL, st - lat_pulse_st);
+  lat_pending = 0;
+}
 #endif
 
+
+#if PULSEDIAL_KBD_BATCH
+/* Keystroke queue for the Teensy keyboard.  Keyboard.print() sends a press report and then a release
+   report for every character, so each key costs two USB polling intervals and a number goes out one
+   key at a time.  Instead, kbd_service() sends one report per ms which releases the previous key AND
+   presses the next, so a run of n keys takes n+1 reports.  Only a repeated key needs a release report
+   of its own in between, since the host would not see a key that stays down as pressed again. */
+
+#define KBD_QUEUE_SIZE 32    /* power of 2 */
+
+unsigned char kbd_queue[KBD_QUEUE_SIZE];   /* HID usage codes */
+unsigned char kbd_mods[KBD_QUEUE_SIZE];    /* modifier keys to hold with each */
+unsigned char kbd_head = 0;
+unsigned char kbd_tail = 0;
+unsigned char kbd_held = 0;           /* usage code of the key now reported down, 0 if none */
+unsigned long kbd_last_ms = 0;        /* millis() of the last report sent */
+unsigned char kbd_lat_mark = 0xFF;    /* queue position just past the digit being timed, 0xFF if none */
+
+#define KBD_SHIFT  0x80     /* in kbd_ascii[] -- usage code needs shift held */
+
+/* HID usage codes for printable ASCII, ' ' to '~', on a US layout */
+const unsigned char kbd_ascii[95] PROGMEM =
+{
+  0x2C, 0x9E, 0xB4, 0xA0, 0xA1, 0xA2, 0xA4, 0x34,   /*   ! " # $ % & ' */
+  0xA6, 0xA7, 0xA5, 0xAE, 0x36, 0x2D, 0x37, 0x38,   /* ( ) * + , - . / */
+  0x27, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24,   /* 0 1 2 3 4 5 6 7 */
+  0x25, 0x26, 0xB3, 0x33, 0xB6, 0x2E, 0xB7, 0xB8,   /* 8 9 : ; < = > ? */
+  0x9F, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A,   /* @ A B C D E F G */
+  0x8B, 0x8C, 0x8D, 0x8E, 0x8F, 0x90, 0x91, 0x92,   /* H I J K L M N O */
+  0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A,   /* P Q R S T U V W */
+  0x9B, 0x9C, 0x9D, 0x2F, 0x31, 0x30, 0xA3, 0xAD,   /* X Y Z [ \ ] ^ _ */
+  0x35, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A,   /* ` a b c d e f g */
+  0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12,   /* h i j k l m n o */
+  0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A,   /* p q r s t u v w */
+  0x1B, 0x1C, 0x1D, 0xAF, 0xB1, 0xB0, 0xB5          /* x y z { | } ~ */
+};
+
+
+/* HID usage code for a character we can type, or 0 -- *mods gets shift added if it needs it */
+
+unsigned char kbd_usage(unsigned char c, unsigned char *mods)
+{
+  unsigned char u;
+
+  if ((c >= ' ') && (c <= '~'))
+    {
+      u = pgm_read_byte(&kbd_ascii[c - ' ']);
+
+      if (u & KBD_SHIFT)
+        {
+          *mods |= (MODIFIERKEY_SHIFT & 0xFF);
+        }
+
+      return u & ~KBD_SHIFT;
+    }
+
+  switch (c)
+    {
+      case '\n':  return (KEY_ENTER & 0xFF);
+      case '\t':  return (KEY_TAB & 0xFF);
+      case '\b':  return (KEY_BACKSPACE & 0xFF);
+      case 0x1B:  return (KEY_ESC & 0xFF);
+      default:    return 0;
+    }
 }
 
 
+/* Queue one key, with modifier keys held -- returns HIGH if queued, LOW if the queue is full */
 
-/* ---- The loop() method runs over and over again, as long as the Arduino has power ----- */
+char kbd_put_key(unsigned char mods, unsigned char usage)
+{
+  unsigned char next;
 
-/* --- User event loop -- must handle events quickly (on average) to keep scheduler from running behind --- */
+  next = (kbd_head + 1) & (KBD_QUEUE_SIZE - 1);
 
-void loop()
+  if (next == kbd_tail)
+    {
+      return 0;
+    }
+
+  kbd_queue[kbd_head] = usage;
+  kbd_mods[kbd_head] = mods;
+  kbd_head = next;
+  return 1;
+}
+
+
+/* Queue a character to be typed -- returns HIGH if queued (or skipped as untypeable), LOW if the
+   queue is full */
+
+char kbd_put(unsigned char c)
 {
-  unsigned int i;
-  unsigned int numpulses;
-  unsigned int numdigit;
-  static char state = 0;
+  unsigned char mods = 0;
+  unsigned char usage;
 
-  /* Handle any user defined manual timer events. */
+  usage = kbd_usage(c, &mods);
 
-  /* Event number 20 was defined in setup() as a 1 second timer.
-     We will repeatedly use the same event number for a 5 second timeout below. */
+  if (!usage)
+    {
+      return 1;
+    }
+
+  return kbd_put_key(mods, usage);
+}
+
+
+/* Send at most one keyboard report -- called every pass of the event loop.  Pacing reports to one
+   per ms keeps Keyboard.send_now() from waiting on a busy endpoint. */
 
-  switch (state)
+void kbd_service(void)
+{
+  unsigned char usage;
+  unsigned long timems;
+
+  timems = millis();
+
+  if (timems == kbd_last_ms)
+    {
+      return;
+    }
+
+  if (kbd_head == kbd_tail)
     {
-      case 0:         /* outside of a dialing period, await initiation of dialing... */
+      if (kbd_held)
         {
-          /* now_dialing_in pin is normally OFF (HIGH) by default */
-          if (sched_pin_golow(now_dialing_in_pin))   /* If now_dialing_in pin went from HIGH to LOW (debounced)... */
-            {
-              /* initiate dialing period */
-              sched_event(20,0,5000);           /* restart 5 second timer */
-              digitalWrite(led_dialing_pin,HIGH);   /* LED on to indicate lockout */
+          /* nothing more to type -- let go of the last key */
+          kbd_held = 0;
+          Keyboard.set_modifier(0);
+          Keyboard.set_key1(0);
+          Keyboard.send_now();
+          kbd_last_ms = timems;
+        }
 
-              /* dial_pulse_in pin should currently be LOW (Normally ON) */
+      return;
+    }
 
-              /* get count (throw it away) of upgoing pulses on dial_pulse_in pin and reset */
-              numpulses = sched_pin_event_count(dial_pulse_in_pin,1,1);
+  usage = kbd_queue[kbd_tail];
 
-              /* show we are in a dialing period */
-              digitalWrite(led_dialing_pin,HIGH);   /* LED on to indicate dialing period */
-              state = 1;
-            }
+  if (usage == kbd_held)
+    {
+      /* same key again -- it has to be seen going up before it can go down */
+      kbd_held = 0;
+      Keyboard.set_modifier(0);
+      Keyboard.set_key1(0);
+      Keyboard.send_now();
+      kbd_last_ms = timems;
+      return;
+    }
 
-          break;
+  kbd_held = usage;
+  Keyboard.set_modifier(kbd_mods[kbd_tail]);
+  Keyboard.set_key1(usage);       /* replaces (so releases) whatever key was down */
+  kbd_tail = (kbd_tail + 1) & (KBD_QUEUE_SIZE - 1);
+  Keyboard.send_now();
+  kbd_last_ms = timems;
+
+#if SCHED_EDGE_TIMES
+  if (kbd_tail == kbd_lat_mark)
+    {
+      lat_handoff();
+      kbd_lat_mark = 0xFF;
+    }
+#endif
+}
+#endif
+
+
+#if PULSEDIAL_MACROS
+/* Dial macros.  Each entry of macro_table pairs a sequence of dialed digits with the text to type for
+   it.  In the text, printable ASCII types as itself (shifted as needed), '\n' '\t' '\b' and "\x1B"
+   give Enter, Tab, Backspace and Esc, and the MK_ prefixes hold modifier keys down for the one key
+   that follows (they add up -- MK_CTRL MK_ALT "t" is Ctrl+Alt+T).  MK_F takes a function key number
+   1 to 12 in the next byte.
+
+   Each dialed digit is added to the sequence so far.  A sequence which is the whole of one entry and
+   the start of no other fires at once.  One which could still grow into a longer entry waits for
+   the next digit, for MACRO_PAUSE_MS without one, or for the end of number (dial held past the
+   timeout) -- and then fires if it is an entry, or else is typed as plain digits.  Digits matching
+   no entry are typed as they are, so a table of only multi-digit sequences leaves ordinary dialing
+   alone apart from those prefixes.
+
+   The table stays in flash.  macro_service() streams the text of fired macros into the keystroke
+   queue a few keys at a time as it drains, so a macro of any length costs no SRAM and never holds up
+   the decoder. */
+
+#define MK_CTRL   "\x01"
+#define MK_SHIFT  "\x02"
+#define MK_ALT    "\x03"
+#define MK_GUI    "\x04"
+#define MK_F      "\x05"
 
+#define MACRO(seq, text)   seq "\0" text "\0"
+
+const char macro_table[] PROGMEM =
+  MACRO("1",    MK_CTRL "c")                       /* copy */
+  MACRO("2",    MK_CTRL "v")                       /* paste */
+  MACRO("3",    MK_CTRL "z")                       /* undo */
+  MACRO("4",    MK_GUI "l")                        /* lock screen */
+  MACRO("5",    MK_F "\x05")                       /* refresh */
+  MACRO("90",   "Mr. Watson -- come here -- I want to see you.\n")
+  MACRO("911",  MK_CTRL MK_ALT "t" "uptime\n")
+  ;   /* the string's own terminating 0 ends the table */
+
+#define MACRO_SEQ_MAX   8        /* longest digit sequence */
+#define MACRO_PAUSE_MS  2000     /* wait this long for the next digit of a longer sequence */
+#define MACRO_JOBS      8        /* power of 2 */
+
+#define MACRO_EXACT   1          /* macro_lookup() -- sequence is an entry */
+#define MACRO_LONGER  2          /* macro_lookup() -- sequence starts a longer entry */
+
+unsigned char macro_seq[MACRO_SEQ_MAX];
+unsigned char macro_seqlen = 0;
+
+/* Fired macros, and digits typed as themselves, waiting to be streamed -- a job is macro text in
+   flash, or a single character when the text pointer is NULL. */
+const char *macro_job_text[MACRO_JOBS];
+unsigned char macro_job_char[MACRO_JOBS];
+unsigned char macro_job_head = 0;
+unsigned char macro_job_tail = 0;
+const char *macro_next = NULL;     /* next byte of the job being streamed, NULL if none */
+
+
+/* Look up the sequence so far -- returns MACRO_EXACT and/or MACRO_LONGER, with *text the macro text
+   in flash if MACRO_EXACT */
+
+unsigned char macro_lookup(const char **text)
+{
+  const char *p = macro_table;
+  unsigned char result = 0;
+  unsigned char i;
+  unsigned char c;
+
+  while (pgm_read_byte(p))
+    {
+      for (i=0; i<macro_seqlen; i++)
+        {
+          if (pgm_read_byte(p + i) != macro_seq[i])
+            {
+              break;
+            }
         }
 
-      case 1:         /* have seen dialing switch go low -- watch for it to gow high again,
-                         signaling end of user dial period... */
+      if (i == macro_seqlen)
         {
-          if (sched_pin_gohigh(now_dialing_in_pin))   /* If now_dialing_in pin went from LOW to HIGH (debounced)... */
+          if (pgm_read_byte(p + i))
+            {
+              result |= MACRO_LONGER;
+            }
+          else
             {
-              /* end dialing period */
-              digitalWrite(led_dialing_pin,LOW);   /* LED off to indicate NOT in dialing period */
+              result |= MACRO_EXACT;
+              *text = p + i + 1;
+            }
+        }
 
-              /* get count of upgoing pulses on dial_pulse_in pin and reset */
-              numpulses = sched_pin_event_count(dial_pulse_in_pin,1,1);
+      /* skip the sequence, then the text */
+      do
+        {
+          c = pgm_read_byte(p++);
+        }
+      while (c);
 
-              /* dial_pulse_in pin should currently be LOW (Normally ON), but ignore it if it isn't */
+      do
+        {
+          c = pgm_read_byte(p++);
+        }
+      while (c);
+    }
 
-              numdigit = numpulses;
+  return result;
+}
 
-              if (numdigit > 9)
-                {
-                  numdigit = 0;
-                }
 
-#ifdef CORE_TEENSY
+void macro_job(const char *text, unsigned char c)
+{
+  unsigned char next;
 
-              if (numpulses > 0)
-                {
-                  Keyboard.print(numdigit);
-                }
+  next = (macro_job_head + 1) & (MACRO_JOBS - 1);
+
+  if (next == macro_job_tail)
+    {
+      return;       /* far behind the host -- drop rather than block the decoder */
+    }
+
+  macro_job_text[macro_job_head] = text;
+  macro_job_char[macro_job_head] = c;
+  macro_job_head = next;
+}
+
+
+/* Settle the sequence so far -- fire it if it is an entry, else type it as plain digits */
+
+void macro_resolve(void)
+{
+  const char *text = NULL;
+  unsigned char i;
+
+  if (!macro_seqlen)
+    {
+      return;
+    }
+
+  if (macro_lookup(&text) & MACRO_EXACT)
+    {
+      macro_job(text, 0);
+    }
+  else
+    {
+      for (i=0; i<macro_seqlen; i++)
+        {
+          macro_job(NULL, macro_seq[i]);
+        }
+    }
+
+  macro_seqlen = 0;
+}
+
+
+void macro_digit(unsigned char digit)
+{
+  const char *text = NULL;
+  unsigned char found;
+
+  macro_seq[macro_seqlen++] = '0' + digit;
+  found = macro_lookup(&text);
+
+  if (!found && (macro_seqlen > 1))
+    {
+      /* the new digit breaks the sequence -- settle what came before, then start again from it */
+      macro_seqlen--;
+      macro_resolve();
+      macro_seq[macro_seqlen++] = '0' + digit;
+      found = macro_lookup(&text);
+    }
+
+  if ((found & MACRO_LONGER) && (macro_seqlen < MACRO_SEQ_MAX))
+    {
+      sched_event(22,0,MACRO_PAUSE_MS);   /* restart the pause timer -- identity 22 */
+      return;
+    }
+
+  macro_resolve();
+}
 
-#else
 
-              if (numpulses > 0)
+/* Stream queued jobs into the keystroke queue while it has room -- called every pass of the event
+   loop.  A macro key (with its modifier prefixes) is read from flash again if it does not fit, so
+   nothing is buffered here. */
+
+void macro_service(void)
+{
+  const char *p;
+  unsigned char mods;
+  unsigned char usage;
+  unsigned char c;
+
+  if (sched_check(22))
+    {
+      macro_resolve();    /* paused part way into a longer sequence */
+    }
+
+  while (1)
+    {
+      if (!macro_next)
+        {
+          if (macro_job_head == macro_job_tail)
+            {
+              return;
+            }
+
+          if (!macro_job_text[macro_job_tail])
+            {
+              /* a plain character */
+              if (!kbd_put(macro_job_char[macro_job_tail]))
                 {
-                  Serial.print(numdigit);
+                  return;
                 }
 
-#endif
-
-              state = 0;
+              macro_job_tail = (macro_job_tail + 1) & (MACRO_JOBS - 1);
+              kbd_lat_mark = kbd_head;      /* hand-off timed when the key goes */
+              continue;
             }
-          else   /* Normal case -- dialing period still in effect */
+
+          macro_next = macro_job_text[macro_job_tail];
+          macro_job_tail = (macro_job_tail + 1) & (MACRO_JOBS - 1);
+          kbd_lat_mark = (kbd_head + 1) & (KBD_QUEUE_SIZE - 1);   /* ...when its first key goes */
+        }
+
+      /* gather one key and its modifier prefixes */
+      p = macro_next;
+      mods = 0;
+      usage = 0;
+
+      while ((c = pgm_read_byte(p)) && !usage)
+        {
+          p++;
+
+          switch (c)
             {
-              /* see if it dialing period should be timed out -- allows 5 seconds --  if user spins dial
-                 and holds it at least that long (with no pulses), program will output a linefeed */
+              case 0x01:  mods |= (MODIFIERKEY_CTRL & 0xFF);   break;
+              case 0x02:  mods |= (MODIFIERKEY_SHIFT & 0xFF);  break;
+              case 0x03:  mods |= (MODIFIERKEY_ALT & 0xFF);    break;
+              case 0x04:  mods |= (MODIFIERKEY_GUI & 0xFF);    break;
 
-              if (sched_check(20))   /* if timer says "dialing timeout" */
+              case 0x05:
                 {
-                  digitalWrite(led_dialing_pin,LOW);   /* LED off */
+                  c = pgm_read_byte(p);
 
-                  /* get count (throw it away) of upgoing pulses on dial_pulse_in pin and reset */
-                  numpulses = sched_pin_event_count(dial_pulse_in_pin,1,1);
+                  if ((c >= 1) && (c <= 12))
+                    {
+                      p++;
+                      usage = (KEY_F1 & 0xFF) + c - 1;
+                    }
 
-                  state = 0;
+                  break;
+                }
 
-#ifdef CORE_TEENSY
-                  /* output a linefeed */
-                  Keyboard.println();
-#else
-                  /* output a linefeed */
-                  Serial.println();
-#endif
+              default:
+                {
+                  usage = kbd_usage(c, &mods);
                 }
             }
-
-          break;
         }
 
-      default:
+      if (usage)
         {
+          if (!kbd_put_key(mods, usage))
+            {
+              return;    /* queue full -- the same key is read again next time */
+            }
         }
+
+      macro_next = c ? p : NULL;
+    }
+}
+#endif
+
+
+#if PULSEDIAL_RAWHID
+/* Raw HID digit stream.  Each 64 byte report sent to the host is
+
+      byte 0      0x01 -- digit event report
+      byte 1      n, number of events (1 to RAWHID_MAX_EVENTS)
+      byte 2      report sequence number
+      bytes 3...  n events of 6 bytes:  millis() when decoded (4 bytes, little-endian),
+                                        digit 0 to 9 or 0xFF for end of number, pulses counted
+
+   Events wait here only while the endpoint is busy, then go out together in one report, so a whole
+   number typically reaches the host in one or two USB frames. */
+
+#define RAWHID_MAX_EVENTS 10
+
+unsigned char rawhid_report[64];
+unsigned char rawhid_count = 0;
+unsigned char rawhid_seq = 0;
+
+
+void rawhid_event(unsigned char digit, unsigned int numpulses)
+{
+  unsigned char *ev;
+  unsigned long ms;
+
+  if (rawhid_count >= RAWHID_MAX_EVENTS)
+    {
+      return;       /* host has stopped reading -- drop rather than block the decoder */
     }
 
-  /* Any other event loop processing, as long as it doesn't take long... */
+  ms = millis();
+  ev = rawhid_report + 3 + (6 * rawhid_count);
+  ev[0] = ms;
+  ev[1] = ms >> 8;
+  ev[2] = ms >> 16;
+  ev[3] = ms >> 24;
+  ev[4] = digit;
+  ev[5] = (numpulses > 255) ? 255 : numpulses;
+  rawhid_count++;
+}
+
+
+void rawhid_service(void)
+{
+  if (!rawhid_count)
+    {
+      return;
+    }
+
+  rawhid_report[0] = 0x01;
+  rawhid_report[1] = rawhid_count;
+  rawhid_report[2] = rawhid_seq;
+
+  if (RawHID.send(rawhid_report, 0) > 0)     /* timeout 0 -- never wait for the endpoint */
+    {
+      rawhid_seq++;
+      rawhid_count = 0;
+#if SCHED_EDGE_TIMES
+      lat_handoff();
+#endif
+    }
+}
+#endif
+
+
+#if PULSEDIAL_TELEMETRY
+#if !PULSEDIAL_SOFTUART
+/* Output hooks for glf_telemetry -- only ever hand HardwareSerial what fits in its own buffer,
+   so the event loop never waits on the UART.  (glf_softuart provides its own.) */
+
+int serial_room(void)
+{
+  return Serial.availableForWrite();
+}
+
+
+void serial_putbyte(unsigned char c)
+{
+  Serial.write(c);
+}
+#endif
+
+
+/* Report dial and scheduler statistics */
+
+unsigned char bounce_report = 2;     /* next contact to report by telemetry, 2 if none */
+
+void send_stats(void)
+{
+  sched_stats st;
+  telem_sched_stats rec;
+  telem_usage use;
+
+  dial_stats.ms = millis();
+  telem_send(TELEM_DIAL_STATS, &dial_stats, sizeof(dial_stats));
+
+  sched_get_stats(&st);
+  rec.ms = dial_stats.ms;
+  rec.ticks = st.ticks;
+  rec.isr_total = st.isr_total;
+  rec.isr_last = st.isr_last;
+  rec.isr_max = st.isr_max;
+  rec.dropped = telem_dropped();
+  rec.deferred = st.deferred;
+  rec.work_max = st.work_max;
+  rec.lag_max = st.lag_max;
+  telem_send(TELEM_SCHED_STATS, &rec, sizeof(rec));
+
+  use.ms = dial_stats.ms;
+  use.pulses = sched_pin_lifetime_count(dial_pulse_in_pin, HIGH);
+  use.dialings = sched_pin_lifetime_count(now_dialing_in_pin, LOW);
+  telem_send(TELEM_USAGE, &use, sizeof(use));
+
+  bounce_report = 0;      /* contact health follows, as TX room allows */
+}
+
+
+/* Contact health of the two dial contacts, one TELEM_BOUNCE record per pass of the event loop as TX
+   room allows -- pin 0 the pulse contact, 1 the off-normal switch.  Each record covers the time since
+   the one before. */
+
+void bounce_pump(void)
+{
+  sched_bounce st;
+  telem_bounce rec;
+
+  if ((TELEM_TX_SIZE - telem_pending()) < (int)(sizeof(rec) + 5))
+    {
+      return;
+    }
+
+  if (sched_bounce_read((bounce_report ? now_dialing_in_pin : dial_pulse_in_pin), &st, 1))
+    {
+      rec.pin = bounce_report;
+      rec.transitions = st.transitions;
+      rec.worst = st.worst;
+      memcpy(rec.bucket, st.hist, sizeof(rec.bucket));
+      telem_send(TELEM_BOUNCE, &rec, sizeof(rec));
+    }
+
+  bounce_report++;
+}
+
+
+#if SCHED_TRACE
+unsigned char trace_pending = 0;   /* nonzero while the trace is being drained into telemetry */
+
+/* Move one TELEM_TRACE record's worth of the scheduler trace into telemetry -- called every pass of
+   the event loop while trace_pending, so the trace drains without holding up the decoder.  An empty
+   record marks the end. */
+
+void trace_pump(void)
+{
+  unsigned char body[TELEM_MAX_BODY];
+  unsigned char n;
+  unsigned char dropped;
+  unsigned long base;
+
+  if ((TELEM_TX_SIZE - telem_pending()) < (TELEM_MAX_BODY + 5))
+    {
+      return;     /* wait until a whole frame is sure to fit, or records would be lost */
+    }
+
+  n = sched_trace_read(body + 5, TELEM_MAX_BODY - 5, &base, &dropped);
+
+  memcpy(body, &base, 4);
+  body[4] = dropped;
+  telem_send(TELEM_TRACE, body, n + 5);
+
+  if (!n)
+    {
+      trace_pending = 0;
+    }
+}
+#endif
+
+#elif SCHED_TRACE
+/* Byte output for sched_trace_dump() -- the trace goes out on the same port as the digits, but it is
+   framed (see glf_scheduler.h) so a host can pick it out of the stream. */
+
+void trace_putbyte(unsigned char c)
+{
+  Serial.write(c);
+}
+#endif
+
+
+/* Hand a decoded digit, or the end of a number, to whichever output this build uses */
+
+void output_digit(unsigned int numdigit, unsigned int numpulses)
+{
+#if PULSEDIAL_TELEMETRY
+  telem_digit rec;
+#endif
+
+  dial_stats.digits++;
+
+#if PULSEDIAL_RAWHID
+  rawhid_event(numdigit, numpulses);     /* hand-off timed when the report goes */
+#elif PULSEDIAL_MACROS
+  macro_digit(numdigit);                 /* hand-off timed when its first key goes */
+#elif PULSEDIAL_KBD_BATCH
+  if (kbd_put('0' + numdigit))
+    {
+      kbd_lat_mark = kbd_head;           /* hand-off timed when the key goes */
+    }
+#else
+#if defined(CORE_TEENSY)
+  Keyboard.print(numdigit);
+#elif PULSEDIAL_TELEMETRY
+  rec.ms = millis();
+  rec.digit = numdigit;
+  rec.pulses = (numpulses > 255) ? 255 : numpulses;
+  telem_send(TELEM_DIGIT, &rec, sizeof(rec));
+#elif PULSEDIAL_SOFTUART
+  suart_write('0' + numdigit);
+#else
+  Serial.print(numdigit);
+#endif
+#if SCHED_EDGE_TIMES
+  lat_handoff();
+#endif
+#endif
+}
+
+
+#if SCHED_EDGE_TIMES
+/* Report the latency histograms -- by telemetry, one stage per pass of the event loop as TX room
+   allows, else as one line of ASCII counts per stage. */
+
+void latency_report(void)
+{
+#if PULSEDIAL_TELEMETRY
+  telem_latency rec;
+
+  if ((TELEM_TX_SIZE - telem_pending()) < (int)(sizeof(rec) + 5))
+    {
+      return;
+    }
+
+  rec.stage = lat_report;
+  memcpy(rec.bucket, lat_hist[lat_report], sizeof(rec.bucket));
+  telem_send(TELEM_LATENCY, &rec, sizeof(rec));
+  lat_report++;
+#else
+  unsigned char b;
+
+  for (lat_report=0; lat_report<LAT_STAGES; lat_report++)
+    {
+      Serial.print("L");
+      Serial.print((unsigned int)lat_report);
+
+      for (b=0; b<TELEM_LAT_BUCKETS; b++)
+        {
+          Serial.print(" ");
+          Serial.print(lat_hist[lat_report][b]);
+        }
+
+      Serial.println();
+    }
+#endif
+}
+#endif
+
+
+void output_eol(void)
+{
+#if PULSEDIAL_TELEMETRY
+  unsigned long ms;
+#endif
+
+  dial_stats.numbers++;
+
+#if PULSEDIAL_RAWHID
+  rawhid_event(0xFF, 0);
+#elif PULSEDIAL_MACROS
+  macro_resolve();     /* the end of number settles any sequence still waiting */
+  macro_job(NULL, '\n');
+#elif PULSEDIAL_KBD_BATCH
+  kbd_put('\n');
+#elif defined(CORE_TEENSY)
+  /* output a linefeed */
+  Keyboard.println();
+#elif PULSEDIAL_TELEMETRY
+  ms = millis();
+  telem_send(TELEM_EOL, &ms, sizeof(ms));
+#elif PULSEDIAL_SOFTUART
+  suart_write('\r');
+  suart_write('\n');
+#else
+  /* output a linefeed */
+  Serial.println();
+#endif
+}
+
+
+/* The decoder -- a glf_fsm machine on the off-normal ("now dialing") pin and timer 20.  The dial
+   is idle until the off-normal switch closes, then dialing until it opens again (a digit, from the
+   pulses counted meanwhile) or until it has been held past the dial timeout (end of number). */
+
+#define DIAL_IDLE      0
+#define DIAL_DIALING   1
+
+#define DIAL_EVENTS    FSM_EV_USER    /* pin, timer and count events -- none of our own */
+
+#define ACT_START      1
+#define ACT_DIGIT      2
+#define ACT_TIMEOUT    3
+
+void dial_start(fsm_machine *m, unsigned char ev);
+void dial_digit(fsm_machine *m, unsigned char ev);
+void dial_timeout(fsm_machine *m, unsigned char ev);
+
+const fsm_trans dial_table[][DIAL_EVENTS] PROGMEM =
+{
+  /*                 GOLOW                            GOHIGH                         TIMER                            COUNT */
+  /* IDLE    */   {  FSM_GO(DIAL_DIALING, ACT_START), FSM_NO,                        FSM_NO,                          FSM_NO },
+  /* DIALING */   {  FSM_NO,                          FSM_GO(DIAL_IDLE, ACT_DIGIT),  FSM_GO(DIAL_IDLE, ACT_TIMEOUT),  FSM_NO },
+};
+
+const fsm_action dial_actions[] PROGMEM = { NULL, dial_start, dial_digit, dial_timeout };
+
+fsm_machine dial_fsm;
+
+
+/* Leaving the dialing period either way -- LED off, and the pulses counted during it */
+
+unsigned int dial_end(void)
+{
+  digitalWrite(led_dialing_pin,LOW);   /* LED off to indicate NOT in dialing period */
+
+  /* dial_pulse_in pin should currently be LOW (Normally ON), but ignore it if it isn't */
+  return sched_pin_event_count(dial_pulse_in_pin,1,1);
+}
+
+
+/* now_dialing_in pin went from HIGH to LOW (debounced) -- initiate dialing period */
+
+void dial_start(fsm_machine *m, unsigned char ev)
+{
+  sched_event(m->timer,0,config.dial_timeout_ms);   /* restart 5 second timer */
+
+  /* get count (throw it away) of upgoing pulses on dial_pulse_in pin and reset */
+  sched_pin_event_count(dial_pulse_in_pin,1,1);
+
+  digitalWrite(led_dialing_pin,HIGH);   /* LED on to indicate dialing period */
+}
+
+
+/* now_dialing_in pin went from LOW to HIGH (debounced) -- end of dialing period, one digit */
+
+void dial_digit(fsm_machine *m, unsigned char ev)
+{
+  unsigned int numpulses;
+  unsigned int numdigit;
+
+  numpulses = dial_end();
+
+#if SCHED_EDGE_TIMES
+  if (numpulses > 0)
+    {
+      lat_decoded();
+    }
+#endif
+
+  numdigit = numpulses;
+
+  if (numdigit > 9)
+    {
+      numdigit = 0;
+    }
+
+  if (numpulses > 10)
+    {
+      dial_stats.overruns++;   /* worn contacts or a dial spinning too fast */
+    }
+
+  if (numpulses > 0)
+    {
+      output_digit(numdigit, numpulses);
+    }
+  else
+    {
+      dial_stats.empties++;
+    }
+}
+
+
+/* Dial held 5 seconds (with no pulses) -- end of number */
+
+void dial_timeout(fsm_machine *m, unsigned char ev)
+{
+  dial_end();       /* throw the count away */
+  output_eol();
+}
+
+
+unsigned char config_sum(void)
+{
+  unsigned char sum = 0;
+  unsigned char i;
+
+  for (i=0; i<(sizeof(config) - 1); i++)
+    {
+      sum += ((unsigned char *)&config)[i];
+    }
+
+  return sum;
+}
+
+
+void config_defaults(void)
+{
+  config.magic = CONFIG_MAGIC;
+  config.version = CONFIG_VERSION;
+  config.led_pin = PULSEDIAL_LED_PIN;
+  config.dialing_pin = PULSEDIAL_DIALING_PIN;
+  config.pulse_pin = PULSEDIAL_PULSE_PIN;
+  config.dial_timeout_ms = 5000;
+  config.holdoff_ms = 1000;
+  sched_get_debounce(&config.db_up, &config.db_down, &config.db_max);
+  config.sum = config_sum();
+}
+
+
+/* Whether a pin can take one of the dial inputs or the LED -- a digital pin the scheduler samples,
+   and not one the serial output lives on (the UART's RX/TX on an Arduino, glf_softuart's PB1 on the
+   ATtiny85; a Teensy talks over USB) */
+
+char config_pin_ok(unsigned int pin)
+{
+  if (pin > MAX_DIGITAL_PIN)
+    {
+      return 0;
+    }
+
+#if defined(__ATtinyX5__)
+  return (pin != 1);
+#elif defined(CORE_TEENSY)
+  return 1;
+#else
+  return (pin > 1);
+#endif
+}
+
+
+/* Read the configuration block and put it into effect -- call first thing in setup() */
+
+void config_load(void)
+{
+  config_defaults();   /* while the scheduler thresholds are still the compile-time ones */
+
+  eeprom_read_block(&config, (const void *)CONFIG_ADDR, sizeof(config));
+
+  if ((config.magic != CONFIG_MAGIC) || (config.version != CONFIG_VERSION)
+      || (config.sum != config_sum())
+      || !config_pin_ok(config.led_pin) || !config_pin_ok(config.dialing_pin)
+      || !config_pin_ok(config.pulse_pin) || (config.dialing_pin == config.pulse_pin)
+      || (config.led_pin == config.dialing_pin) || (config.led_pin == config.pulse_pin)
+      || (!sched_set_debounce(config.db_up, config.db_down, config.db_max)))
+    {
+      config_defaults();
+    }
+
+  led_dialing_pin = config.led_pin;
+  now_dialing_in_pin = config.dialing_pin;
+  dial_pulse_in_pin = config.pulse_pin;
+}
+
+
+/* Start writing the configuration back to EEPROM -- restarts if a save is already under way */
+
+void config_save(void)
+{
+  config.sum = config_sum();
+  config_save_pos = 0;
+}
+
+
+void config_service(void)
+{
+  if (config_save_pos >= sizeof(config))
+    {
+      return;
+    }
+
+  if (!eeprom_is_ready())
+    {
+      return;       /* previous byte still being written -- about 3.3 ms each */
+    }
+
+  /* update only writes the byte if it differs -- spares the EEPROM's limited write cycles */
+  eeprom_update_byte((uint8_t *)(CONFIG_ADDR + config_save_pos), ((unsigned char *)&config)[config_save_pos]);
+  config_save_pos++;
+
+  if (config_save_pos >= sizeof(config))
+    {
+      config_save_pos = 0xFF;
+    }
+}
+
+
+#if PULSEDIAL_SHELL
+/* Configuration command shell.  Bytes from the serial port are fed in one per pass of the event loop
+   and gathered into a line, which is acted on at CR or LF -- so a command never holds up decoding.
+   Commands, with the reply:
+
+      show                  one "name value" reply per setting
+      set <name> <value>    "ok", "ok -- save and reset to apply" (holdoff), or "?" if refused
+      save                  "ok" -- written to EEPROM in the background
+      defaults              "ok" -- compile-time settings back in effect (save to keep them);
+                            "ok -- save and reset to apply" if the pins in use differ from the
+                            compile-time ones, which only move at the next boot
+
+   Names are led, dialing, pulse (pin numbers), timeout, holdoff (ms), up, down, max (debounce).
+   The 'T' and 'L' report requests still work as single bytes at the start of a line.  With
+   telemetry on, each reply goes out as a TELEM_TEXT record. */
+
+#define SHELL_LINE_MAX 24
+
+char shell_line[SHELL_LINE_MAX];
+unsigned char shell_len = 0;        /* SHELL_LINE_MAX while discarding an overlong line */
+
+const char *const shell_names[] = { "led", "dialing", "pulse", "timeout", "holdoff", "up", "down", "max" };
+
+#define SHELL_NAMES (sizeof(shell_names) / sizeof(shell_names[0]))
+
+
+void shell_reply(const char *text)
+{
+#if PULSEDIAL_TELEMETRY
+  telem_send(TELEM_TEXT, text, strlen(text));
+#else
+  Serial.println(text);
+#endif
+}
+
+
+/* Value of one setting by its index in shell_names[] */
+
+unsigned int shell_get(unsigned char n)
+{
+  switch (n)
+    {
+      case 0:   return config.led_pin;
+      case 1:   return config.dialing_pin;
+      case 2:   return config.pulse_pin;
+      case 3:   return config.dial_timeout_ms;
+      case 4:   return config.holdoff_ms;
+      case 5:   return config.db_up;
+      case 6:   return config.db_down;
+      default:  return config.db_max;
+    }
+}
+
+
+/* Move a debounced input to another pin -- the scheduler swaps the new list in between ticks, so
+   the other input loses no samples.  Returns LOW if the pin is already taken, or a swap is still
+   pending. */
+
+char shell_move_pin(int *pin, unsigned char to)
+{
+  if ((to == *pin) || (to == now_dialing_in_pin) || (to == dial_pulse_in_pin) || (to == led_dialing_pin))
+    {
+      return (to == *pin);
+    }
+
+  if (!sched_stage_begin(0, 1))
+    {
+      return 0;
+    }
+
+  pinMode(to, INPUT_PULLUP);
+  sched_stage_drop(*pin);
+  sched_stage_event(to, 1, 1);
+
+  if (pin == &dial_pulse_in_pin)
+    {
+      sched_set_priority(to, SCHED_PRIO_CRITICAL);
+#if PULSEDIAL_HWCOUNT
+      sched_pin_hwcount((to == SCHED_T1_PIN) ? to : -1, HIGH, PULSEDIAL_HW_HOLDOFF);
+#endif
+    }
+
+  sched_stage_commit();
+
+#if PULSEDIAL_TELEMETRY
+  sched_bounce_watch(*pin, 0);
+  sched_bounce_watch(to, 1);
+  sched_pin_lifetime(*pin, 0);    /* the count starts over on a new pin */
+  sched_pin_lifetime(to, 1);
+#endif
+
+  if (pin == &now_dialing_in_pin)
+    {
+      dial_fsm.pin = to;
+      sched_pin_idle(*pin, 0, 0);
+      sched_pin_idle(to, PULSEDIAL_IDLE_MS, PULSEDIAL_IDLE_SLOW);
+    }
+
+  *pin = to;
+  return 1;
+}
+
+
+/* Change one setting -- returns "ok" style reply, or NULL if refused */
+
+const char *shell_set(unsigned char n, unsigned int val)
+{
+  char up = config.db_up;
+  char down = config.db_down;
+  char max = config.db_max;
+
+  switch (n)
+    {
+      case 0:
+      case 1:
+      case 2:
+        {
+          if (!config_pin_ok(val))
+            {
+              return NULL;     /* not sampled, or the serial port's */
+            }
+
+          /* nor one the saved settings give another use -- after "defaults" they can differ from
+             the pins in use until the reset, and a clash would throw the whole block out at boot */
+          if (((n != 0) && (val == config.led_pin)) || ((n != 1) && (val == config.dialing_pin))
+              || ((n != 2) && (val == config.pulse_pin)))
+            {
+              return NULL;
+            }
+
+          if (n == 0)
+            {
+              if (((int)val == now_dialing_in_pin) || ((int)val == dial_pulse_in_pin))
+                {
+                  return NULL;
+                }
+
+              digitalWrite(led_dialing_pin, LOW);
+              led_dialing_pin = config.led_pin = val;
+              pinMode(led_dialing_pin, OUTPUT);
+            }
+          else if (n == 1)
+            {
+              if (!shell_move_pin(&now_dialing_in_pin, val))
+                {
+                  return NULL;
+                }
+
+              config.dialing_pin = val;
+            }
+          else
+            {
+              if (!shell_move_pin(&dial_pulse_in_pin, val))
+                {
+                  return NULL;
+                }
+
+              config.pulse_pin = val;
+            }
+
+          return "ok";
+        }
+
+      case 3:
+        {
+          if (val < 1000)
+            {
+              return NULL;     /* shorter than one slow digit would end numbers mid-dial */
+            }
+
+          config.dial_timeout_ms = val;
+          return "ok";
+        }
+
+      case 4:
+        {
+          config.holdoff_ms = val;
+          return "ok -- save and reset to apply";
+        }
+
+      default:
+        {
+          if (val > 100)
+            {
+              return NULL;
+            }
+
+          if (n == 5)       up = val;
+          else if (n == 6)  down = val;
+          else              max = val;
+
+          if (!sched_set_debounce(up, down, max))
+            {
+              return NULL;
+            }
+
+          config.db_up = up;
+          config.db_down = down;
+          config.db_max = max;
+          return "ok";
+        }
+    }
+}
+
+
+/* Split the next space-separated word off *p -- returns NULL at end of line */
+
+char *shell_word(char **p)
+{
+  char *w;
+
+  while (**p == ' ')
+    {
+      (*p)++;
+    }
+
+  if (!**p)
+    {
+      return NULL;
+    }
+
+  w = *p;
+
+  while (**p && (**p != ' '))
+    {
+      (*p)++;
+    }
+
+  if (**p)
+    {
+      *(*p)++ = 0;
+    }
+
+  return w;
+}
+
+
+void shell_exec(void)
+{
+  char reply[SHELL_LINE_MAX];
+  char *p = shell_line;
+  char *cmd;
+  char *name;
+  char *arg;
+  const char *result = NULL;
+  unsigned char n;
+  unsigned int val;
+
+  cmd = shell_word(&p);
+  name = shell_word(&p);
+  arg = shell_word(&p);
+
+  if (!cmd)
+    {
+      return;
+    }
+
+  for (n=0; name && (n<SHELL_NAMES); n++)
+    {
+      if (!strcmp(name, shell_names[n]))
+        {
+          break;
+        }
+    }
+
+  if (!strcmp(cmd, "show"))
+    {
+      for (n=0; n<SHELL_NAMES; n++)
+        {
+          val = shell_get(n);
+          strcpy(reply, shell_names[n]);
+          p = reply + strlen(reply);
+          *p++ = ' ';
+          utoa(val, p, 10);
+          shell_reply(reply);
+        }
+
+      return;
+    }
+
+  if (!strcmp(cmd, "set") && name && arg && (n < SHELL_NAMES))
+    {
+      val = 0;
+
+      for (p=arg; (*p >= '0') && (*p <= '9'); p++)
+        {
+          val = (val * 10) + (*p - '0');
+        }
+
+      if (!*p)
+        {
+          result = shell_set(n, val);
+        }
+    }
+  else if (!strcmp(cmd, "save"))
+    {
+      config_save();
+      result = "ok";
+    }
+  else if (!strcmp(cmd, "defaults"))
+    {
+      sched_set_debounce(0, 0, 0);    /* the scheduler's own defaults */
+      config_defaults();
+
+      /* the inputs cannot all be moved live -- one staged swap at a time, and the defaults may
+         name each other's pins -- so any pin change waits for the reset */
+      if ((led_dialing_pin != PULSEDIAL_LED_PIN) || (now_dialing_in_pin != PULSEDIAL_DIALING_PIN)
+          || (dial_pulse_in_pin != PULSEDIAL_PULSE_PIN))
+        {
+          result = "ok -- save and reset to apply";
+        }
+      else
+        {
+          result = "ok";
+        }
+    }
+
+  shell_reply(result ? result : "?");
+}
+
+
+/* Take one byte from the serial port */
+
+void shell_feed(char c)
+{
+  if ((c == '\r') || (c == '\n'))
+    {
+      if (shell_len == SHELL_LINE_MAX)
+        {
+          shell_reply("?");
+        }
+      else if (shell_len)
+        {
+          shell_line[shell_len] = 0;
+          shell_exec();
+        }
+
+      shell_len = 0;
+      return;
+    }
+
+  if (shell_len < (SHELL_LINE_MAX - 1))
+    {
+      shell_line[shell_len++] = c;
+    }
+  else
+    {
+      shell_len = SHELL_LINE_MAX;    /* too long -- discard up to the end of the line */
+    }
+}
+#endif
+
+
+/* --------- The setup() method runs once, when the sketch starts ------------------- */
+
+void setup()
+{
+  config_load();                  /* pins, timeouts, debounce thresholds */
+
+  pinMode(led_dialing_pin, OUTPUT);
+  digitalWrite(led_dialing_pin,LOW);   /* LED off */
+
+  pinMode(now_dialing_in_pin,  INPUT_PULLUP);
+  pinMode(dial_pulse_in_pin, INPUT_PULLUP);
+
+  sched_list_init(0);             /* prepare an empty schedule list -- ignore analog pins */
+  sched_event(dial_pulse_in_pin,1,1);  /* set up a recurring 1 ms timer to debounce dial_pulse_in pin */
+  sched_event(now_dialing_in_pin,1,1);   /* set up a recurring 1 ms timer to debounce now_dialing_in pin */
+  sched_set_priority(dial_pulse_in_pin, SCHED_PRIO_CRITICAL);   /* pulses are the one thing we can't miss */
+  sched_pin_idle(now_dialing_in_pin, PULSEDIAL_IDLE_MS, PULSEDIAL_IDLE_SLOW);   /* idle nearly all the time */
+
+#if PULSEDIAL_TELEMETRY
+  sched_bounce_watch(dial_pulse_in_pin, 1);    /* contact health, reported with the statistics */
+  sched_bounce_watch(now_dialing_in_pin, 1);
+  sched_pin_lifetime(dial_pulse_in_pin, 1);    /* usage, likewise */
+  sched_pin_lifetime(now_dialing_in_pin, 1);
+#endif
+
+  fsm_init(&dial_fsm, &dial_table[0][0], DIAL_EVENTS, dial_actions, DIAL_IDLE);
+  dial_fsm.pin = now_dialing_in_pin;
+  dial_fsm.timer = 20;
+#if PULSEDIAL_HWCOUNT
+  sched_pin_hwcount(dial_pulse_in_pin, HIGH, PULSEDIAL_HW_HOLDOFF);   /* refused unless it is on T1 */
+#endif
+
+#ifdef CORE_TEENSY
+  /* set up to hold off for 10 seconds -- gives keyboard time to be recognized and enumerated */
+  sched_event(20,0,config.holdoff_ms);   /* set up a nonrecurring 1 second timer -- identity 20 */
+
+  /* Serial.begin(9600); */  /* use keyboard instead -- no setup needed */
+
+  /* Wait until 10 second timer elapses */
+  while (!(sched_check(20)))
+    {
+    }
+
+#else
+  /* set up to hold off for 1 second */
+  sched_event(20,0,config.holdoff_ms);   /* set up a nonrecurring 1 second timer -- identity 20 */
+
+#if PULSEDIAL_TELEMETRY && PULSEDIAL_SOFTUART
+  suart_begin(57600);
+  telem_begin(suart_room, suart_putbyte);
+  telem_send(TELEM_TEXT, "GLF pulsedial_key -- ATtiny85", 29);
+#elif PULSEDIAL_TELEMETRY
+  Serial.begin(115200);
+  telem_begin(serial_room, serial_putbyte);
+  telem_send(TELEM_TEXT, "GLF pulsedial_key -- Arduino", 28);
+#elif PULSEDIAL_SOFTUART
+  suart_begin(57600);
+#else
+  Serial.begin(9600);
+  Serial.println("GLF 2015/05/19 -- pulsedial_serial.ino -- Arduino");
+#endif
+
+  /* Wait until 1 second timer elapses */
+  while (!(sched_check(20)))
+    {
+    }
+
+#if PULSEDIAL_TELEMETRY
+  sched_event(21,1,10000);       /* recurring 10 second timer for statistics -- identity 21 */
+#endif
+
+#endif
+
+}
+
+
+
+/* ---- The loop() method runs over and over again, as long as the Arduino has power ----- */
+
+/* --- User event loop -- must handle events quickly (on average) to keep scheduler from running behind --- */
+
+void loop()
+{
+#if !PULSEDIAL_SOFTUART
+  int c;
+#endif
+
+  sched_service();   /* runs the scheduler ticks if built with SCHED_BACKEND_COOP, else nothing */
+
+  /* Event number 20 was defined in setup() as a 1 second timer.
+     The decoder uses the same event number for its 5 second timeout. */
+
+  fsm_poll(&dial_fsm);
+
+  /* Any other event loop processing, as long as it doesn't take long... */
+
+  /* Single character commands on the serial port:
+        'T'  scheduler event trace -- when a unit misdials, shows what the debounced pins and
+             timers actually did
+        'L'  latency histograms
+     and everything else to the configuration shell, one byte per pass.  (No receive on the ATtiny85.) */
+#if !PULSEDIAL_SOFTUART
+  if (Serial.available())
+    {
+      c = Serial.read();
+
+#if PULSEDIAL_SHELL
+      if (shell_len)     /* part way into a command line -- not a single character command */
+        {
+          shell_feed(c);
+          c = -1;
+        }
+#endif
+
+      switch (c)
+        {
+#if SCHED_TRACE
+          case 'T':
+            {
+#if PULSEDIAL_TELEMETRY
+              trace_pending = 1;
+#else
+              sched_trace_dump(trace_putbyte);
+#endif
+              break;
+            }
+#endif
+
+#if SCHED_EDGE_TIMES
+          case 'L':
+            {
+              lat_report = 0;
+              latency_report();
+              break;
+            }
+#endif
+
+          default:
+            {
+#if PULSEDIAL_SHELL
+              if (c >= 0)
+                {
+                  shell_feed(c);
+                }
+#endif
+            }
+        }
+    }
+#endif
+
+  config_service();
+
+#if PULSEDIAL_TELEMETRY
+  if (sched_check(21))   /* every 10 seconds */
+    {
+      send_stats();
+    }
+
+#if SCHED_TRACE
+  if (trace_pending)
+    {
+      trace_pump();
+    }
+#endif
+
+#if SCHED_EDGE_TIMES
+  if (lat_report < LAT_STAGES)
+    {
+      latency_report();
+    }
+#endif
+
+  if (bounce_report < 2)
+    {
+      bounce_pump();
+    }
+
+  telem_service();
+#endif
+
+#if PULSEDIAL_MACROS
+  macro_service();
+#endif
+
+#if PULSEDIAL_KBD_BATCH
+  kbd_service();
+#endif
+
+#if PULSEDIAL_RAWHID
+  rawhid_service();
+#endif
 }
 
@@ -0,0 +1,112 @@
+/* glf_fsm library                     17 Oct 2026 agent
+
+   Table-driven finite state machines -- see glf_fsm.h for the table format.
+
+*/
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include "WProgram.h"
+#endif
+
+#include "glf_fsm.h"
+#include "glf_scheduler.h"
+
+#ifndef pgm_read_ptr
+#define pgm_read_ptr(p) ((void *)pgm_read_word(p))
+#endif
+
+
+extern "C"    /* begin C-only code */
+{
+
+  void fsm_init(fsm_machine *m, const fsm_trans *table, unsigned char nevents,
+                const fsm_action *actions, unsigned char state)
+  {
+    m->table = table;
+    m->actions = actions;
+    m->nevents = nevents;
+    m->state = state;
+    m->pin = -1;
+    m->timer = -1;
+    m->count_pin = -1;
+    m->user = NULL;
+  }
+
+
+  /* The table entry for an event in the current state */
+
+  static const fsm_trans *fsm_entry0(fsm_machine *m, unsigned char ev)
+  {
+    return m->table + ((unsigned int)m->state * m->nevents) + ev;
+  }
+
+
+  static char fsm_handles0(fsm_machine *m, unsigned char ev)
+  {
+    return (pgm_read_byte(&fsm_entry0(m, ev)->next) != FSM_NONE);
+  }
+
+
+  char fsm_event(fsm_machine *m, unsigned char ev)
+  {
+    const fsm_trans *t;
+    unsigned char next;
+    unsigned char action;
+    fsm_action f;
+
+    if (ev >= m->nevents)
+      {
+        return 0;
+      }
+
+    t = fsm_entry0(m, ev);
+    next = pgm_read_byte(&t->next);
+
+    if (next == FSM_NONE)
+      {
+        return 0;
+      }
+
+    action = pgm_read_byte(&t->action);
+    m->state = next;
+
+    if (action)
+      {
+        f = (fsm_action)pgm_read_ptr(&m->actions[action]);
+        f(m, ev);
+      }
+
+    return 1;
+  }
+
+
+  char fsm_poll(fsm_machine *m)
+  {
+    char level;
+
+    if ((m->pin >= 0) && (fsm_handles0(m, FSM_EV_GOLOW) || fsm_handles0(m, FSM_EV_GOHIGH)))
+      {
+        level = sched_pin_change(m->pin);
+
+        if ((level >= 0) && fsm_event(m, (level ? FSM_EV_GOHIGH : FSM_EV_GOLOW)))
+          {
+            return 1;
+          }
+      }
+
+    if ((m->timer >= 0) && fsm_handles0(m, FSM_EV_TIMER) && sched_check(m->timer))
+      {
+        return fsm_event(m, FSM_EV_TIMER);
+      }
+
+    if ((m->count_pin >= 0) && fsm_handles0(m, FSM_EV_COUNT) && sched_pin_count_ready(m->count_pin))
+      {
+        return fsm_event(m, FSM_EV_COUNT);
+      }
+
+    return 0;
+  }
+
+}             /* end C-only code */
@@ -0,0 +1,106 @@
+/* glf_fsm library                     17 Oct 2026 agent
+
+   Table-driven finite state machines for glf_scheduler projects -- replaces a switch(state) in the
+   user event loop, with its side effects repeated case by case, by a transition table in PROGMEM
+   and a short list of action functions.
+
+   The table has one row per state and one column per event:
+
+      FSM_EV_GOLOW    the machine's pin went HIGH to LOW (debounced)
+      FSM_EV_GOHIGH   ...LOW to HIGH
+      FSM_EV_TIMER    the machine's timer ran out (sched_check())
+      FSM_EV_COUNT    the machine's count pin reached its threshold (sched_pin_count_at())
+      FSM_EV_USER...  events of the application's own, given to fsm_event()
+
+   Each entry names the next state and an action, or is FSM_NO to ignore the event in that state.
+   Dispatch is a single table lookup however many states and events there are.  fsm_poll() asks the
+   scheduler only about the events the current state has entries for, so an event nobody is waiting
+   for is not used up (a timer which runs out while idle is still there to be seen later), just as a
+   hand-written switch would only call sched_check() in the states which care.
+
+   Many machines may share one table -- each fsm_machine holds its own state, pins and timer, and a
+   user pointer for the application's data, e.g. one machine per dial.
+
+      const fsm_trans my_table[][MY_EVENTS] PROGMEM =
+      {
+        { FSM_GO(RUN, ACT_START), FSM_NO,                  FSM_NO, ... },     state IDLE
+        { FSM_NO,                 FSM_GO(IDLE, ACT_STOP),  ...         },     state RUN
+      };
+
+      const fsm_action my_actions[] PROGMEM = { NULL, my_start, my_stop };   entry 0 is "no action"
+
+*/
+
+#ifndef __GLF_FSM_H__
+#define __GLF_FSM_H__ 1
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include "WProgram.h"
+#endif
+
+#include <avr/pgmspace.h>
+
+
+/* Event numbers -- a table's rows are at least FSM_EV_USER wide */
+
+#define FSM_EV_GOLOW    0
+#define FSM_EV_GOHIGH   1
+#define FSM_EV_TIMER    2
+#define FSM_EV_COUNT    3
+#define FSM_EV_USER     4
+
+#define FSM_NONE        0xFF    /* next state of an ignored event */
+
+#define FSM_GO(next, action)  { (next), (action) }
+#define FSM_NO                { FSM_NONE, 0 }
+
+
+typedef struct
+{
+  unsigned char next;           /* state after the event, FSM_NONE to ignore it */
+  unsigned char action;         /* index into the action list, 0 for none */
+}
+fsm_trans;
+
+typedef struct fsm_machine fsm_machine;
+
+/* An action is called after the machine has moved to its next state, with the event which moved it.
+   It may call fsm_event() on the same machine. */
+typedef void (*fsm_action)(fsm_machine *m, unsigned char ev);
+
+struct fsm_machine
+{
+  const fsm_trans *table;       /* PROGMEM -- states rows of nevents entries */
+  const fsm_action *actions;    /* PROGMEM */
+  unsigned char nevents;
+  unsigned char state;
+  char pin;                     /* debounced pin for GOLOW and GOHIGH, -1 for none */
+  char timer;                   /* scheduler timer ident for TIMER, -1 for none */
+  char count_pin;               /* pin whose count threshold gives COUNT, -1 for none */
+  void *user;                   /* the application's, for this machine */
+};
+
+
+extern "C"    /* begin C-only code */
+{
+
+  void fsm_init(fsm_machine *m, const fsm_trans *table, unsigned char nevents,
+                const fsm_action *actions, unsigned char state);
+  /* Set up a machine in the given state, with no pins or timer -- fill in pin, timer, count_pin
+     and user afterwards as wanted, and give the count pin its threshold with sched_pin_count_at().
+     nevents is the width of a table row, at least FSM_EV_USER. */
+
+  char fsm_event(fsm_machine *m, unsigned char ev);
+  /* Give the machine one event -- returns HIGH if it made a transition, LOW if the event is ignored
+     in its current state. */
+
+  char fsm_poll(fsm_machine *m);
+  /* Check the machine's pin, timer and count pin for the events its current state handles, in that
+     order, and make at most one transition -- call once per pass of the event loop.  Returns HIGH if
+     it made a transition. */
+
+}             /* end C-only code */
+
+#endif   /* ... of __GLF_FSM_H__ */
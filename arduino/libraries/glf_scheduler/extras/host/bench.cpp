@@ -0,0 +1,164 @@
+/* Host benchmarks -- the figures quoted for the scheduler's load-spreading features, measured the
+   same way every time.  Counts, not cycles: the host says nothing about AVR timing, so anything in
+   Timer0 counts still needs a measurement on the target.
+
+   Usage: bench
+
+   stagger  five pins on 5 ms -- the most pin samples any one tick takes (sched_stats.work_max).
+            Build with and without SCHED_STAGGER to compare.
+   idle     one pin on sched_pin_idle(100, 20) and a plain one, fed the same signal with a burst of
+            bounce and a clean edge -- ticks on which their levels differ, and the samples replaced
+            by register peeks.
+   latency  a 1 ms pin toggled every 200 ms, with loop() held up 4 ms in every 50 -- mean and worst
+            ms from the pin changing to sched_pin_level() seeing it, and the ticks sched_service()
+            found owed.  Build with and without SCHED_BACKEND_COOP to compare.
+
+   unsigned long is 64 bits on the host, so the 32-bit wrap of stamps is not exercised here.
+*/
+
+#include <stdio.h>
+
+#include "glf_scheduler.h"
+
+extern "C" void TIMER0_COMPB_vect(void);
+
+
+static void bench_tick(void)
+{
+  mock_ms++;
+#if SCHED_BACKEND_COOP
+  sched_service();
+#else
+  TCNT0 = 4;
+  TIMER0_COMPB_vect();
+#endif
+}
+
+
+static void bench_stagger(void)
+{
+  sched_stats st;
+  char i;
+  int t;
+
+  sched_list_init(0);
+
+  for (i=2; i<7; i++)
+    {
+      sched_event(i, 1, 5);
+    }
+
+  sched_clear_stats();
+
+  for (t=0; t<1000; t++)
+    {
+      bench_tick();
+    }
+
+  sched_get_stats(&st);
+  printf("stagger  SCHED_STAGGER=%d  ticks %lu  work_max %u\n", SCHED_STAGGER, st.ticks, st.work_max);
+}
+
+
+static void bench_idle(void)
+{
+  sched_stats st;
+  unsigned long differ = 0;
+  int t;
+
+  mock_pin[6] = 1;
+  mock_pin[7] = 1;
+
+  sched_list_init(0);
+  sched_event(6, 1, 1);
+  sched_event(7, 1, 1);
+  sched_pin_idle(6, 100, 20);
+  sched_clear_stats();
+
+  for (t=0; t<3000; t++)
+    {
+      if ((t == 1000) || (t == 1003) || (t == 1006) || (t == 2000))
+        {
+          mock_pin[6] = !mock_pin[6];     /* bounce, then settle -- and a clean edge */
+        }
+
+      mock_pin[7] = mock_pin[6];
+      bench_tick();
+
+      if (sched_pin_level(6, 1) != sched_pin_level(7, 1))
+        {
+          differ++;
+        }
+    }
+
+  sched_get_stats(&st);
+  printf("idle     ticks %lu  differing %lu  peeks %lu  edges %u/%u\n", st.ticks, differ, st.peeks,
+         sched_pin_event_count(6, 1, 0) + sched_pin_event_count(6, 0, 0),
+         sched_pin_event_count(7, 1, 0) + sched_pin_event_count(7, 0, 0));
+}
+
+
+static void bench_latency(void)
+{
+  sched_stats st;
+  unsigned long total = 0;
+  unsigned long worst = 0;
+  unsigned long n = 0;
+  long changed = -1;
+  int t;
+
+  mock_pin[6] = 0;
+
+  sched_list_init(0);
+  sched_event(6, 1, 1);
+  sched_clear_stats();
+
+  for (t=0; t<20000; t++)
+    {
+      if (!(t % 200))
+        {
+          mock_pin[6] = !mock_pin[6];
+          changed = t;
+        }
+
+      mock_ms++;
+#if SCHED_BACKEND_COOP
+      if (((t % 50) < 45) || ((t % 50) == 49))    /* no sched_service() call for 4 ms in every 50 */
+        {
+          sched_service();
+        }
+#else
+      TCNT0 = 4;
+      TIMER0_COMPB_vect();
+#endif
+
+      if ((changed >= 0) && (sched_pin_level(6, 1) == mock_pin[6]))
+        {
+          total += t - changed;
+          n++;
+
+          if ((unsigned long)(t - changed) > worst)
+            {
+              worst = t - changed;
+            }
+
+          changed = -1;
+        }
+    }
+
+  sched_get_stats(&st);
+  printf("latency  SCHED_BACKEND_COOP=%d  edges %lu  mean %lu.%02lu ms  worst %lu ms  lag_max %u  skipped %lu\n",
+         SCHED_BACKEND_COOP, n, total / n, (total * 100 / n) % 100, worst, st.lag_max, st.skipped);
+}
+
+
+int main(void)
+{
+  mock_ms = 1000;
+
+  bench_stagger();
+  bench_idle();
+  bench_latency();
+
+  return 0;
+}
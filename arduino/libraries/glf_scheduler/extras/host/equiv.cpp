@@ -0,0 +1,160 @@
+/* Host equivalence run -- drives glf_scheduler through a pseudo-random stream of pin levels, timer
+   set-ups and API calls, one 1 ms tick at a time, and prints every call and what it returned.  Only
+   the API of the 2015/05/18 library is used, so the same program builds against reference/ (that
+   library, verbatim) and against the library in development.  run.sh builds both and compares the
+   two outputs line by line -- any difference is a change in behaviour somebody has to explain.
+
+   Usage: equiv [seed [ms]]
+
+   The stream, per tick:
+     - each pin holds its level, mostly; now and then it changes, sometimes cleanly and sometimes
+       with a burst of bounce lasting a few ms
+     - millis() moves on and the Timer0 COMPB ISR is called, as the hardware would
+     - a few API calls, picked at random: (re)registering pins (0 to 9 ms, so undebounced pins are
+       in there too) and timers (once or recurring, 0 to 50 ms), sched_cancel(), sched_check(),
+       sched_pin_event_count() with and without reset, sched_pin_gohigh/golow/level()
+
+   Pin periods stay under 10 ms, and the library in development must be built with SCHED_STAGGER
+   off -- those are the two places its behaviour was changed on purpose.  No analog channels are
+   scanned; the host has no ADC.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "glf_scheduler.h"
+
+extern "C" void TIMER0_COMPB_vect(void);
+
+#define EQ_PINS    6        /* pins 2 to 7 */
+#define EQ_TIMERS  5        /* timers 20 to 24 */
+
+static unsigned long eq_seed;
+
+static unsigned int eq_rand(unsigned int n)     /* 0 to n-1 */
+{
+  eq_seed = eq_seed * 1103515245UL + 12345UL;
+  return (unsigned int)((eq_seed >> 16) & 0x7FFF) % n;
+}
+
+
+int main(int argc, char **argv)
+{
+  unsigned long steps = 20000;
+  unsigned long t;
+  unsigned char level[EQ_PINS];
+  unsigned char bounce[EQ_PINS];
+  char ident;
+  int i;
+  int calls;
+
+  eq_seed = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1;
+  steps = (argc > 2) ? strtoul(argv[2], NULL, 0) : steps;
+
+  mock_ms = 1000;
+
+  for (i=0; i<EQ_PINS; i++)
+    {
+      level[i] = eq_rand(2);
+      bounce[i] = 0;
+      mock_pin[2 + i] = level[i];
+    }
+
+  sched_list_init(0);
+
+  for (i=0; i<EQ_PINS; i++)
+    {
+      sched_event(2 + i, 1, eq_rand(10));
+    }
+
+  for (t=0; t<steps; t++)
+    {
+      /* pins */
+      for (i=0; i<EQ_PINS; i++)
+        {
+          if (bounce[i])
+            {
+              bounce[i]--;
+              mock_pin[2 + i] = bounce[i] ? eq_rand(2) : level[i];
+            }
+          else if (!eq_rand(150))
+            {
+              level[i] = !level[i];
+              bounce[i] = eq_rand(3) ? 0 : (1 + eq_rand(12));
+              mock_pin[2 + i] = bounce[i] ? !level[i] : level[i];
+            }
+        }
+
+      /* tick */
+      mock_ms++;
+      TCNT0 = 4;
+      TIMER0_COMPB_vect();
+
+      /* calls */
+      calls = eq_rand(4);
+
+      while (calls--)
+        {
+          if (eq_rand(2))
+            {
+              ident = 2 + eq_rand(EQ_PINS);
+            }
+          else
+            {
+              ident = 20 + eq_rand(EQ_TIMERS);
+            }
+
+          /* pins are mostly left registered, or their counts would never get far */
+          switch (eq_rand(ident < 20 ? 64 : 16))
+            {
+              case 0:
+                i = (ident < 20) ? eq_rand(10) : eq_rand(51);
+                printf("%lu event %d %d %d = %d\n", t, ident, (ident < 20) ? 1 : (i & 1), i,
+                       sched_event(ident, (ident < 20) ? 1 : (i & 1), i));
+                break;
+
+              case 1:
+                if ((ident >= 20) || !eq_rand(4))
+                  {
+                    printf("%lu cancel %d = %d\n", t, ident, sched_cancel(ident));
+                  }
+                break;
+
+              case 2: case 3: case 4:
+                printf("%lu check %d = %d\n", t, ident, sched_check(ident));
+                break;
+
+              case 5: case 6:
+                i = eq_rand(4);
+                printf("%lu count %d %d %d = %u\n", t, ident, i & 1, i >> 1,
+                       sched_pin_event_count(ident, i & 1, i >> 1));
+                break;
+
+              case 7: case 8: case 9:
+                printf("%lu gohigh %d = %d\n", t, ident, sched_pin_gohigh(ident));
+                break;
+
+              case 10: case 11: case 12:
+                printf("%lu golow %d = %d\n", t, ident, sched_pin_golow(ident));
+                break;
+
+              case 13: case 14: case 15:
+                i = eq_rand(2);
+                printf("%lu level %d %d = %d\n", t, ident, i, sched_pin_level(ident, i));
+                break;
+
+              default:
+                break;
+            }
+        }
+    }
+
+  /* and where every pin ended up */
+  for (i=0; i<EQ_PINS; i++)
+    {
+      printf("end %d up %u down %u level %d\n", 2 + i, sched_pin_event_count(2 + i, 1, 0),
+             sched_pin_event_count(2 + i, 0, 0), sched_pin_level(2 + i, 1));
+    }
+
+  return 0;
+}
@@ -0,0 +1,66 @@
+/* Host stand-in for the parts of the Arduino core and AVR registers glf_scheduler uses -- just
+   enough to build the library with g++ on a PC and drive it from a test program.  The clock and
+   the pins are set by the test: mock_ms is millis(), micros() runs 1000 to the ms, and pin p reads
+   as mock_pin[p].  Interrupts are a no-op; the test calls the ISR itself, once per tick. */
+
+#ifndef __MOCK_ARDUINO_H__
+#define __MOCK_ARDUINO_H__ 1
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+
+#define ISR(v) extern "C" void v(void)
+#define sei() do {} while (0)
+#define cli() do {} while (0)
+#define _BV(b) (1 << (b))
+#define sbi(r,b) ((r) |= _BV(b))
+#define cbi(r,b) ((r) &= ~_BV(b))
+
+extern volatile uint8_t SREG, TCNT0, TCCR0A, TCCR0B, OCR0A, OCR0B, TIMSK0, TIMSK, TIFR0, TIFR;
+extern volatile uint8_t ADCL, ADCH, ADCSRA, ADCSRB, ADMUX;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+extern volatile uint16_t TCNT1;
+
+enum { TOIE0 = 0, OCIE0A = 1, OCIE0B = 2, OCF0A = 1, OCF0B = 2, WGM00 = 0, WGM01 = 1,
+       CS00 = 0, CS01 = 1, CS02 = 2, CS10 = 0, CS11 = 1, CS12 = 2,
+       ADTS0 = 0, ADTS1 = 1, ADTS2 = 2, ADIF = 4, ADATE = 5, ADSC = 6, ADEN = 7 };
+
+/* no ADC -- the library's "#if defined(ADCSRA) && defined(ADCL)" paths stay out */
+
+extern "C"
+{
+  extern unsigned long mock_ms;
+  extern uint8_t mock_pin[32];
+
+  unsigned long millis(void);
+  unsigned long micros(void);
+  int digitalRead(uint8_t pin);
+  void digitalWrite(uint8_t pin, uint8_t val);
+  void pinMode(uint8_t pin, uint8_t mode);
+  int analogRead(uint8_t pin);
+}
+
+/* one input "port" per pin, every bit of it the pin's level -- so register peeks and digitalRead()
+   always agree */
+#define digitalPinToPort(p) (p)
+#define digitalPinToBitMask(p) ((uint8_t)0x01)
+#define portInputRegister(p) (&mock_pin[(p)])
+#define NOT_A_PIN 0xFF
+
+#endif   /* ... of __MOCK_ARDUINO_H__ */
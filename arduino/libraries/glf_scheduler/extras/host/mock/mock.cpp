@@ -0,0 +1,43 @@
+/* Host stand-in for the Arduino core -- see Arduino.h here */
+
+#include <Arduino.h>
+
+volatile uint8_t SREG, TCNT0, TCCR0A, TCCR0B, OCR0A, OCR0B, TIMSK0, TIMSK, TIFR0, TIFR;
+volatile uint8_t ADCL, ADCH, ADCSRA, ADCSRB, ADMUX;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+volatile uint16_t TCNT1;
+
+extern "C"
+{
+  unsigned long mock_ms = 0;
+  uint8_t mock_pin[32];
+
+  unsigned long millis(void)
+  {
+    return mock_ms;
+  }
+
+  unsigned long micros(void)
+  {
+    return mock_ms * 1000UL;
+  }
+
+  int digitalRead(uint8_t pin)
+  {
+    return mock_pin[pin] & 1;
+  }
+
+  void digitalWrite(uint8_t pin, uint8_t val)
+  {
+    mock_pin[pin] = val ? 0xFF : 0;
+  }
+
+  void pinMode(uint8_t pin, uint8_t mode)
+  {
+  }
+
+  int analogRead(uint8_t pin)
+  {
+    return 0;
+  }
+}
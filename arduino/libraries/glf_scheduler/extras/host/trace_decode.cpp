@@ -0,0 +1,209 @@
+/* Host decoder for sched_trace_dump() output -- reads the raw bytes from the serial port (a capture
+   file, or a pipe) and prints one line per record, with the absolute millis() time of each:
+
+      <ms> edge <ident> <level>     debounced pin edge
+      <ms> timer <ident>            user timer expiry
+      <ms> isr <counts>             new worst-case ISR duration, in Timer0 counts
+      <ms> mark <code>              sched_trace_mark()
+      <ms> dropped <n>              n records were overwritten before this frame could take them
+
+   Usage: trace_decode [capture]      (stdin if no file given)
+
+   Anything between frames -- other output on the same port -- is skipped, and a frame with a bad sum
+   or records which do not fill it exactly is reported on stderr and resynchronised past.  The exit
+   status is 1 if any frame was bad.  The text is what trace_run replays (see there).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "glf_scheduler.h"
+
+static unsigned char *td_buf;
+static unsigned long td_len;
+
+
+static int td_read(FILE *f)
+{
+  unsigned long size = 4096;
+  size_t n;
+
+  td_buf = (unsigned char *)malloc(size);
+
+  while (td_buf && ((n = fread(td_buf + td_len, 1, size - td_len, f)) > 0))
+    {
+      td_len += n;
+
+      if (td_len == size)
+        {
+          size *= 2;
+          td_buf = (unsigned char *)realloc(td_buf, size);
+        }
+    }
+
+  return (td_buf != NULL);
+}
+
+
+/* Decode the records of the frame at p, whose length byte is n -- returns 0, printing nothing, if
+   they do not come out to exactly n bytes */
+
+static int td_frame(unsigned long p, unsigned char n, int print)
+{
+  unsigned long t;
+  unsigned long dt;
+  unsigned long q;
+  unsigned long end;
+  unsigned char hdr;
+  unsigned char shift;
+  unsigned char b;
+
+  t = td_buf[p + 3] | ((unsigned long)td_buf[p + 4] << 8) | ((unsigned long)td_buf[p + 5] << 16)
+      | ((unsigned long)td_buf[p + 6] << 24);
+
+  if (print && td_buf[p + 7])
+    {
+      printf("%lu dropped %u\n", t, td_buf[p + 7]);
+    }
+
+  q = p + 8;
+  end = q + n;
+
+  while (q < end)
+    {
+      hdr = td_buf[q++];
+      dt = 0;
+      shift = 0;
+
+      do
+        {
+          if ((q >= end) || (shift > 28))
+            {
+              return 0;
+            }
+
+          b = td_buf[q++];
+          dt |= (unsigned long)(b & 0x7F) << shift;
+          shift += 7;
+        }
+      while (b & 0x80);
+
+      if (q >= end)
+        {
+          return 0;     /* no payload byte */
+        }
+
+      t += dt;
+      b = td_buf[q++];
+
+      if (!print)
+        {
+          continue;
+        }
+
+      switch (hdr & 0xF0)
+        {
+          case SCHED_TRC_EDGE:
+            printf("%lu edge %u %u\n", t, b, hdr & 0x01);
+            break;
+
+          case SCHED_TRC_TIMER:
+            printf("%lu timer %u\n", t, b);
+            break;
+
+          case SCHED_TRC_ISR:
+            printf("%lu isr %u\n", t, b);
+            break;
+
+          case SCHED_TRC_MARK:
+            printf("%lu mark %u\n", t, b);
+            break;
+
+          default:
+            printf("%lu ? %02x %u\n", t, hdr, b);
+            break;
+        }
+    }
+
+  return 1;
+}
+
+
+int main(int argc, char **argv)
+{
+  FILE *f = stdin;
+  unsigned long p = 0;
+  unsigned long skipped = 0;
+  unsigned long frames = 0;
+  unsigned long bad = 0;
+  unsigned char n;
+  unsigned char sum;
+  unsigned int i;
+
+  if ((argc > 1) && !(f = fopen(argv[1], "rb")))
+    {
+      perror(argv[1]);
+      return 2;
+    }
+
+  if (!td_read(f))
+    {
+      fprintf(stderr, "trace_decode: out of memory\n");
+      return 2;
+    }
+
+  /* 0x7E 'T' n base(4) dropped <n bytes> sum */
+  while (p < td_len)
+    {
+      if ((td_buf[p] != 0x7E) || ((p + 1) >= td_len) || (td_buf[p + 1] != 'T'))
+        {
+          skipped++;
+          p++;
+          continue;
+        }
+
+      if ((p + 9) > td_len)
+        {
+          fprintf(stderr, "trace_decode: frame cut short at byte %lu\n", p);
+          bad++;
+          break;
+        }
+
+      n = td_buf[p + 2];
+
+      if ((p + 9 + n) > td_len)
+        {
+          fprintf(stderr, "trace_decode: frame cut short at byte %lu\n", p);
+          bad++;
+          break;
+        }
+
+      sum = 0;
+
+      for (i=0; i<(unsigned int)(n + 6); i++)
+        {
+          sum += td_buf[p + 2 + i];
+        }
+
+      if ((sum != td_buf[p + 8 + n]) || !td_frame(p, n, 0))
+        {
+          fprintf(stderr, "trace_decode: bad frame at byte %lu -- resynchronising\n", p);
+          bad++;
+          p++;
+          continue;
+        }
+
+      td_frame(p, n, 1);
+      frames++;
+      p += 9 + n;
+    }
+
+  if (skipped)
+    {
+      fprintf(stderr, "trace_decode: %lu bytes outside frames skipped\n", skipped);
+    }
+
+  fprintf(stderr, "trace_decode: %lu frames, %lu bad\n", frames, bad);
+
+  return bad ? 1 : 0;
+}
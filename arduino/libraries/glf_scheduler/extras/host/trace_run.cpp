@@ -0,0 +1,290 @@
+/* Host trace record and replay -- the two ends of a round trip through sched_trace_dump() and
+   trace_decode.  Both write the dump bytes to stdout, a frame every 16 ms and the rest at the end, the
+   way a sketch would send them down the serial port.
+
+   Usage: trace_run record [seed [ms]]
+          trace_run replay < decoded
+
+   record   debounced 1 ms pins 2 to 7 fed a pseudo-random signal with bursts of bounce (as equiv
+            does), user timer 20 recurring every 7 ms and timer 21 re-armed once it expires for 1 to
+            50 ms, and a sched_trace_mark() of the count every 250 ms.
+
+   replay   reads trace_decode's text and drives the scheduler so it records the same trace again:
+            every pin with an edge is registered undebounced (sched_event(ident,1,0)) and driven to
+            each edge's level on that edge's ms, every timer record gets a 1 ms timer armed the ms
+            before, and the marks are made again.  The ms the records carry are absolute, so the replay
+            runs on the same clock as the original.
+
+   What replay cannot bring back: the trace keeps debounced edges, not the raw signal, so the bounce
+   that went into them -- and how long each took to confirm -- is gone.  The replay reproduces what
+   the rest of the program saw (the edges, counts and levels, on the same ms), not what the contacts
+   did.  Nor does it say which order the pins were registered in, which decides the order of edges on
+   different pins in the same ms -- the replay registers them lowest ident first.  Likewise a timer
+   record says when a timer expired, not how it was set up.  isr records are measurements of the
+   original run and are skipped, and if the decoded text shows dropped records, whatever happened in
+   the gap is missing from the replay too.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glf_scheduler.h"
+
+extern "C" void TIMER0_COMPB_vect(void);
+
+#define TR_PINS     6       /* record -- pins 2 to 7 */
+#define TR_EVENTS   100000  /* replay -- records taken from the decoded text */
+
+typedef struct
+{
+  unsigned long t;
+  char kind;                /* 'e'dge, 't'imer or 'm'ark */
+  unsigned char a;          /* ident, or mark code */
+  unsigned char b;          /* level of an edge */
+}
+tr_event;
+
+static tr_event tr_ev[TR_EVENTS];
+static unsigned long tr_n;
+static unsigned long tr_seed;
+
+
+static unsigned int tr_rand(unsigned int n)     /* 0 to n-1 */
+{
+  tr_seed = tr_seed * 1103515245UL + 12345UL;
+  return (unsigned int)((tr_seed >> 16) & 0x7FFF) % n;
+}
+
+
+static void tr_put(unsigned char c)
+{
+  putchar(c);
+}
+
+
+static void tr_tick(void)
+{
+  mock_ms++;
+  TCNT0 = 4;
+  TIMER0_COMPB_vect();
+}
+
+
+static int tr_record(unsigned long steps)
+{
+  unsigned char level[TR_PINS];
+  unsigned char bounce[TR_PINS];
+  unsigned long t;
+  int i;
+
+  mock_ms = 1000;
+
+  for (i=0; i<TR_PINS; i++)
+    {
+      level[i] = tr_rand(2);
+      bounce[i] = 0;
+      mock_pin[2 + i] = level[i];
+    }
+
+  sched_list_init(0);
+
+  for (i=0; i<TR_PINS; i++)
+    {
+      sched_event(2 + i, 1, 1);
+    }
+
+  sched_event(20, 1, 7);
+  sched_event(21, 0, 1 + tr_rand(50));
+  sched_trace_clear();
+
+  for (t=0; t<steps; t++)
+    {
+      for (i=0; i<TR_PINS; i++)
+        {
+          if (bounce[i])
+            {
+              bounce[i]--;
+              mock_pin[2 + i] = bounce[i] ? tr_rand(2) : level[i];
+            }
+          else if (!tr_rand(150))
+            {
+              level[i] = !level[i];
+              bounce[i] = tr_rand(3) ? 0 : (1 + tr_rand(12));
+              mock_pin[2 + i] = bounce[i] ? !level[i] : level[i];
+            }
+        }
+
+      tr_tick();
+
+      sched_check(20);
+
+      if (sched_check(21))
+        {
+          sched_event(21, 0, 1 + tr_rand(50));
+        }
+
+      if (!(mock_ms % 250))
+        {
+          sched_trace_mark((mock_ms / 250) & 0xFF);
+        }
+
+      if (!(mock_ms % 16))
+        {
+          sched_trace_dump(tr_put);
+        }
+    }
+
+  sched_trace_dump(tr_put);
+
+  return 0;
+}
+
+
+static int tr_replay(void)
+{
+  char line[80];
+  char kind[16];
+  unsigned long t;
+  unsigned int a;
+  unsigned int b;
+  unsigned long next = 0;
+  unsigned long i;
+  unsigned char seen[256];
+
+  while (fgets(line, sizeof(line), stdin))
+    {
+      b = 0;
+
+      if ((sscanf(line, "%lu %15s %u %u", &t, kind, &a, &b) < 3) || (a > 255))
+        {
+          continue;
+        }
+
+      if (!strcmp(kind, "dropped"))
+        {
+          fprintf(stderr, "trace_run: %u records were dropped at %lu ms -- the replay has a gap\n", a, t);
+          continue;
+        }
+
+      if ((strcmp(kind, "edge") && strcmp(kind, "timer") && strcmp(kind, "mark")) || (tr_n >= TR_EVENTS))
+        {
+          continue;       /* isr, or no room */
+        }
+
+      tr_ev[tr_n].t = t;
+      tr_ev[tr_n].kind = kind[0];
+      tr_ev[tr_n].a = a;
+      tr_ev[tr_n].b = b;
+      tr_n++;
+    }
+
+  if (!tr_n)
+    {
+      return 0;
+    }
+
+  mock_ms = tr_ev[0].t - 2;
+  sched_list_init(0);
+
+  /* each pin starts at the level its first edge leaves */
+  memset(seen, 0, sizeof(seen));
+
+  for (i=0; i<tr_n; i++)
+    {
+      if ((tr_ev[i].kind == 'e') && !seen[tr_ev[i].a] && (tr_ev[i].a < 32))
+        {
+          seen[tr_ev[i].a] = 1;
+          mock_pin[tr_ev[i].a] = !tr_ev[i].b;
+        }
+      else if (tr_ev[i].kind == 't')
+        {
+          seen[tr_ev[i].a] = 2;
+        }
+    }
+
+  for (a=0; a<32; a++)
+    {
+      if (seen[a] == 1)
+        {
+          sched_event(a, 1, 0);     /* lowest ident first -- see above */
+        }
+    }
+
+  for (i=0; (i<tr_n) && (tr_ev[i].t == (mock_ms + 1)); i++)
+    {
+      if (tr_ev[i].kind == 't')
+        {
+          sched_event(tr_ev[i].a, 0, 1);
+        }
+    }
+
+  sched_trace_clear();
+
+  while (next < tr_n)
+    {
+      /* the levels go in before the tick that sees them */
+      for (i=next; (i<tr_n) && (tr_ev[i].t == (mock_ms + 1)); i++)
+        {
+          if (tr_ev[i].kind == 'e')
+            {
+              mock_pin[tr_ev[i].a] = tr_ev[i].b;
+            }
+        }
+
+      tr_tick();
+
+      for (a=0; a<256; a++)
+        {
+          if (seen[a] == 2)
+            {
+              sched_check(a);
+            }
+        }
+
+      for (i=next; (i<tr_n) && (tr_ev[i].t == mock_ms); i++)
+        {
+          if (tr_ev[i].kind == 'm')
+            {
+              sched_trace_mark(tr_ev[i].a);
+            }
+        }
+
+      next = i;
+
+      for (; (i<tr_n) && (tr_ev[i].t == (mock_ms + 1)); i++)
+        {
+          if (tr_ev[i].kind == 't')
+            {
+              sched_event(tr_ev[i].a, 0, 1);
+            }
+        }
+
+      if (!(mock_ms % 16))
+        {
+          sched_trace_dump(tr_put);
+        }
+    }
+
+  sched_trace_dump(tr_put);
+
+  return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+  if ((argc > 1) && !strcmp(argv[1], "record"))
+    {
+      tr_seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1;
+      return tr_record((argc > 3) ? strtoul(argv[3], NULL, 0) : 20000);
+    }
+
+  if ((argc > 1) && !strcmp(argv[1], "replay"))
+    {
+      return tr_replay();
+    }
+
+  fprintf(stderr, "usage: trace_run record [seed [ms]] | trace_run replay < decoded\n");
+  return 2;
+}
@@ -1,5 +1,79 @@
 /* glf_scheduler library                    18 May 2015 GLF
 
+   2026/10/17 agent -- add a cooperative backend (SCHED_BACKEND_COOP) for cores which need Timer0's
+                       compare channels -- sched_service() in the user event loop runs the ticks,
+                       catching up on any it was late for.  A no-op with the ISR backend.
+
+   2026/10/17 agent -- sort the sampled pins into rate buckets (every tick, every 10, every 100) so
+                       the ISR no longer walks the whole list each tick -- user timers are skipped,
+                       and pins of 10 ms or more are looked at only on their bucket's tick.  A pin
+                       seen a whole period late skips the samples it missed, keeping its phase.
+
+   2026/10/17 agent -- add adaptive sampling (sched_pin_idle()) -- a pin stable for a while is only
+                       peeked at through its input register until it moves, with a full sample now
+                       and then.  Samples per pass now count pin samples actually taken.
+
+   2026/10/17 agent -- stagger recurring entries (SCHED_STAGGER) -- a new one of the same period as
+                       others is placed half way across the widest gap between their phases, so
+                       their samples no longer all land on one tick; sched_event_phase() sets a phase
+                       outright.  Pin samples per pass added to sched_stats.
+
+   2026/10/17 agent -- add lifetime counts (sched_pin_lifetime()) -- 32-bit transition counts for
+                       usage metering; the ISR keeps 16-bit low words and counts their carries.
+
+   2026/10/17 agent -- add contact health (sched_bounce_watch()) -- raw flips per debounced
+                       transition and a histogram of bounces, for spotting worn contacts.
+
+   2026/10/17 agent -- add gated measurements (sched_measure_start()) -- rising edges, period and
+                       duty cycle of a pin over a repeating gate window, published once per gate.
+
+   2026/10/17 agent -- add count thresholds (sched_pin_count_at()) -- the ISR flags a pin whose event
+                       count reaches N, for sched_pin_count_ready() to pick up.
+
+   2026/10/17 agent -- add sched_pin_change() -- one check for a change either way, for glf_fsm.
+
+   2026/10/17 agent -- add sub-tick stamps (sched_stamp()) -- tick count and TCNT0 in one unsigned
+                       long, one unit per Timer0 count.  Edge times are now stamps, not millis().
+
+   2026/10/17 agent -- add optional second sampling phase (SCHED_TWO_PHASE) -- the Timer0 COMPA
+                       interrupt, half a period after COMPB, samples again the every-tick pins put
+                       on it with sched_pin_two_phase().
+
+   2026/10/17 agent -- add sched_pin_hwcount() -- the pin on T1 can have its edges counted by Timer1
+                       instead of sampled every tick, with an optional firmware glitch filter.
+
+   2026/10/17 agent -- add optional hardware-triggered analog scan (SCHED_ADC_AUTO) -- conversions
+                       start on the Timer0 overflow at a fixed phase, and the ISR only harvests them.
+
+   2026/10/17 agent -- add resistor ladder decoding -- each band of one scanned channel is a virtual
+                       button, ident SCHED_LADDER_PIN(b), LOW while pressed (sched_ladder()).
+
+   2026/10/17 agent -- add analog virtual pins -- idents SCHED_ANALOG_PIN(ch) debounce a scanned
+                       analog channel through per-channel hysteresis thresholds (sched_analog_pin()).
+
+   2026/10/17 agent -- add pin priority classes and a per-tick time budget -- critical pins are
+                       serviced first every tick, then normal pins and the analog scan while the
+                       budget lasts.  The analog scan now follows the pins.
+
+   2026/10/17 agent -- add staged reconfiguration (sched_stage_begin() and friends) -- a new schedule
+                       list is built alongside the live one and swapped in by the ISR between ticks,
+                       carrying pin state across.  Fix sched_event() initializing the wrong slot's
+                       debounce state when re-registering a pin.
+
+   2026/10/17 agent -- add sched_set_debounce() -- debounce thresholds can be set at run time.
+
+   2026/10/17 agent -- add optional raw and confirmed edge times per pin (SCHED_EDGE_TIMES) for
+                       latency measurement.
+
+   2026/10/17 agent -- add sched_get_stats() -- ISR pass count and durations, measured from TCNT0.
+
+   2026/10/17 agent -- add optional event trace ring (SCHED_TRACE) -- pin edges, timer expiries
+                       and worst-case ISR durations, drained as framed binary by sched_trace_dump().
+
+   2026/10/17 agent -- split the debounce integrator out of sched_check0() and add an optional
+                       shadow reference (SCHED_SHADOW_CHECK) so engine rewrites can be checked
+                       sample-for-sample against the 2015/05/18 behaviour.
+
    2015/05/18 GLF -- Add functionality to allow event counting of transitions and events
                      consistent with other glf_scheduler elements
 
@@ -73,26 +147,509 @@ extern "C"    /* begin C-only code */
 
   /*  constants for debouncing keystrokes -- assume tested every 1 ms
       -- simulate a low-pass filter into a Schmitt trigger  */
-#define DEBOUNCE_THRESH_UP     15
+#define DEBOUNCE_THRESH_UP     15    /* defaults -- sched_set_debounce() changes them at run time */
 #define DEBOUNCE_THRESH_DOWN    5
 #define DEBOUNCE_THRESH_MAX    20
 #define DEBOUNCE_THRESH_BOTTOM  0
 
-  static sched schedlist[MAX_SCHED+1];
+  static volatile char sched_db_up = DEBOUNCE_THRESH_UP;
+  static volatile char sched_db_down = DEBOUNCE_THRESH_DOWN;
+  static volatile char sched_db_max = DEBOUNCE_THRESH_MAX;
+
+  /* Two schedule lists -- the live one, walked by the ISR, and the staging one, built up by
+     sched_stage_event() and swapped in by the ISR between ticks.  The ISR changes schedlist and
+     sched_count, hence volatile. */
+  static sched schedbuf[2][MAX_SCHED+1];
+  static sched * volatile schedlist = schedbuf[0];
   static unsigned int sched_analoglist[MAX_ANALOG_PIN+1];
-  static char sched_count = 0;
+  static volatile char sched_count = 0;
+
+  /* Analog virtual pins -- hysteresis thresholds per channel, and the level each channel last
+     crossed to (one bit per channel), kept up by the analog scan */
+  static unsigned int sched_analog_lo[MAX_ANALOG_PIN+1];
+  static unsigned int sched_analog_hi[MAX_ANALOG_PIN+1];
+  static volatile unsigned char sched_analog_levels = 0;
+
+  /* Resistor ladder -- one channel, band upper bounds, a coarse lookup (reading >> SCHED_LADDER_SHIFT
+     gives the lowest band that reading could be in), and one level bit per button, LOW when pressed */
+#define SCHED_LADDER_SHIFT 5
+#define SCHED_LADDER_CELLS (1024 >> SCHED_LADDER_SHIFT)
+  static unsigned char sched_ladder_ch = 0xFF;        /* 0xFF when no ladder */
+  static unsigned char sched_ladder_n = 0;
+  static unsigned int sched_ladder_bounds[SCHED_LADDER_MAX];
+  static unsigned char sched_ladder_lut[SCHED_LADDER_CELLS];
+  static volatile unsigned char sched_ladder_levels = 0xFF;
+
+  static sched *schedstage = schedbuf[1];
+  static char sched_stage_count = 0;
+  static unsigned char sched_stage_analogs = 0;
+  static char sched_stage_carry[MAX_SCHED+1];         /* live slot each staged slot takes state from, or -1 */
+  static volatile char sched_stage_ready = 0;         /* nonzero from sched_stage_commit() until the swap */
+  static volatile unsigned char sched_api_busy = 0;   /* nonzero while a call in loop() holds a live list position --
+                                                         the ISR puts the swap off a tick.  A count, as calls nest. */
+
+  static unsigned char sched_budget = 0;              /* Timer0 counts per tick for non-critical work, 0 for no limit */
+  static char sched_defer_next = 0;                   /* normal pin of bucket 0 the pass starts from */
+
+  /* Rate buckets -- the live list positions of the pins the ISR samples, by how often it has to look:
+     every tick (critical pins first, then normal ones of under 10 ms), every 10 ticks (10 to 99 ms),
+     and every 100.  User timers are in none, since the user event loop checks them.  Rebuilt with
+     interrupts off whenever the list changes. */
+#define SCHED_BUCKETS 3
+
+  static const unsigned char sched_bucket_ms[SCHED_BUCKETS] = { 1, 10, 100 };
+  static char sched_bucket[SCHED_BUCKETS][MAX_SCHED+1];
+  static char sched_bucket_n[SCHED_BUCKETS] = { 0, 0, 0 };
+  static char sched_bucket_crit = 0;                  /* critical pins at the front of bucket 0 */
+  static unsigned char sched_bucket_left[SCHED_BUCKETS] = { 1, 10, 105 };   /* ticks to the next visit --
+                                                                           offset so the two never coincide */
+
+  /* Gated measurements -- the gate being counted, and the last one closed, per pool entry */
+  typedef struct
+  {
+    char ident;                   /* pin measured, -1 for a free entry */
+    unsigned char raw;            /* nonzero to take raw samples rather than the debounced level */
+    unsigned char last;           /* level at the previous sample */
+    unsigned int gate_ms;
+    unsigned long start_ms;       /* millis() the gate opened */
+    unsigned int edges;           /* rising edges so far */
+    unsigned int high;            /* samples HIGH so far */
+    unsigned int samples;
+    unsigned long first_st;       /* stamps of the first and latest rising edge */
+    unsigned long last_st;
+    unsigned int pub_edges;       /* ...and as at the close of the last gate */
+    unsigned int pub_high;
+    unsigned int pub_samples;
+    unsigned long pub_span;       /* stamps from first to last rising edge */
+    unsigned int pub_gates;       /* gates closed */
+  }
+  sched_meas;
+
+  static sched_meas sched_measlist[SCHED_MEASURE_MAX];
+  static volatile unsigned char sched_meas_used = 0;   /* entries in use -- the ISR skips the pool if 0 */
+
+  /* Contact health -- raw flips since the last debounced transition, and the statistics, per entry */
+  typedef struct
+  {
+    char ident;                   /* pin watched, -1 for a free entry */
+    unsigned char flips;
+    sched_bounce st;
+  }
+  sched_bnc;
+
+  static sched_bnc sched_bnclist[SCHED_BOUNCE_MAX];
+  static volatile unsigned char sched_bnc_used = 0;
+
+  /* Lifetime counts -- the ISR keeps the low words and counts their carries, the high words are
+     only touched by sched_pin_lifetime_count() */
+  typedef struct
+  {
+    char ident;                   /* pin counted, -1 for a free entry */
+    volatile unsigned int lo_up;
+    volatile unsigned int lo_down;
+    volatile unsigned char carry_up;
+    volatile unsigned char carry_down;
+    unsigned int hi_up;
+    unsigned int hi_down;
+  }
+  sched_life;
+
+  static sched_life sched_lifelist[SCHED_LIFETIME_MAX];
+  static volatile unsigned char sched_life_used = 0;
+
+  /* Adaptive sampling -- a pin stable for idle_after samples is only peeked at through its input
+     register each tick, with a full sample every slow ticks, until the peek sees it move */
+  typedef struct
+  {
+    char ident;                   /* pin, -1 for a free entry */
+    volatile uint8_t *reg;        /* its input register... */
+    unsigned char mask;           /* ...and its bit there */
+    unsigned int idle_after;
+    unsigned int quiet;           /* stable samples so far */
+    unsigned char slow;
+    unsigned char slow_left;      /* ticks to the next full sample while idle */
+  }
+  sched_idle;
+
+  static sched_idle sched_idlelist[SCHED_IDLE_MAX];
+  static volatile unsigned char sched_idle_used = 0;
+  static unsigned char sched_work = 0;     /* pin samples taken in the current pass */
+
   static unsigned long sched_priorms = 0;
   static unsigned char sched_num_analogs = 0;
   static unsigned char sched_current_analog = 0;
 
+#ifdef SCHED_T1_PIN
+  /* Hardware pulse counting -- the slot Timer1 counts for (-1 for none), the TCNT1 value counts are
+     taken from, and for the firmware glitch filter the holdoff, the ms of it left, and the TCNT1
+     value seen on the last tick */
+  static volatile char sched_t1_ident = -1;
+  static unsigned int sched_t1_base = 0;
+  static unsigned char sched_t1_holdoff = 0;
+  static unsigned char sched_t1_hold = 0;
+  static unsigned int sched_t1_last = 0;
+#endif
+
+#if SCHED_ADC_AUTO
+  /* Hardware-triggered conversions run two deep -- the channel each was started on, by the overflow
+     of this tick (busy) and of the tick before (prev), 0xFF for none; and the channel ADMUX holds */
+  static unsigned char sched_adc_busy = 0xFF;
+  static unsigned char sched_adc_prev = 0xFF;
+  static unsigned char sched_adc_mux = 0;
+#endif
+
+  static sched_stats sched_stat;      /* written by ISR only -- read through sched_get_stats() */
+  static volatile unsigned long sched_ticks = 0;   /* COMPB passes since startup -- the top of a stamp */
+
   static volatile char sched_initialized = 0;         /* Only nonzero when fully set up (including ISR). */
   static volatile char sched_ISR_installed = 0;       /* Only nonzero when ISR has been initialized. */
+#if SCHED_BACKEND_COOP
+  static unsigned long sched_service_ms = 0;          /* millis() of the last tick sched_service() ran */
+  static unsigned long sched_coop_st = 0;             /* stamp, counted up in Timer0 units from micros() */
+  static unsigned long sched_coop_us = 0;             /* micros() sched_coop_st was last brought up to */
+#endif
+#if SCHED_TWO_PHASE
+  static volatile char sched_isr_busy = 0;            /* COMPB work in progress -- COMPA stays out */
+#endif
 
   static void (*vecptr)(void) = NULL;    /* Will hold pointer to original TIMER0_OVF_vect code
                                           when initialized.  Cannot statically assign
                                           the correct address -- must calculate at runtime. */
 
 
+#if SCHED_SHADOW_CHECK
+  static volatile char sched_shadow_latched = 0;
+  static sched_divergence sched_shadow_first;
+
+  /* Reference integrator -- the 2015/05/18 code of sched_check0(), unchanged except that it works on the
+     reference copy of the state, is handed the sample rather than reading the pin itself, and shares the
+     (run-time) thresholds with the live engine.
+     DO NOT "improve" this function: its whole purpose is to stay the same. */
+
+  static void sched_ref_debounce0(sched_ref *r, unsigned char level, char debounce)
+  {
+    if (level)
+      {
+        /* if pin is HIGH... */
+        if (!debounce)
+          {
+            r->debounce_ct = sched_db_max;  /* Immediately force Schmitt trigger action */
+          }
+        else
+          {
+            /* if instantaneously HIGH, count up to simulate low-pass filter */
+            r->debounce_ct++;
+          }
+
+        /* simulate Schmitt trigger (hysteresis) */
+        if (r->debounce_ct > sched_db_up)
+          {
+            r->debounce_ct = sched_db_max;  /* Schmitt trigger action */
+
+            if (!(r->debounce_state))    /* if it WAS LOW... */
+              {
+                r->debounce_change++;     /* indicate changed state until checked by user */
+                r->event_ct_up++;         /* indicate up count until reset by user */
+              }
+
+            r->debounce_state = HIGH;   /* force state at this threshold */
+          }
+      }
+    else
+      {
+        /* if pin is LOW... */
+
+        if (!debounce)
+          {
+            r->debounce_ct = DEBOUNCE_THRESH_BOTTOM;  /* Immediately force Schmitt trigger action */
+          }
+        else
+          {
+            /* if instantaneously LOW, count down to simulate low-pass filter */
+            r->debounce_ct--;
+          }
+
+        /* simulate Schmitt trigger (hysteresis) */
+        if (r->debounce_ct < sched_db_down)
+          {
+            r->debounce_ct = DEBOUNCE_THRESH_BOTTOM;  /* Schmitt trigger action */
+
+            if (r->debounce_state)     /* if it WAS HIGH... */
+              {
+                r->debounce_change++;     /* indicate changed state until checked by user */
+                r->event_ct_down++;       /* indicate down count until reset by user */
+              }
+
+            r->debounce_state = LOW;   /* force state at this threshold */
+          }
+      }
+  }
+
+
+  static void sched_shadow_sync0(sched *s)    /* make the reference agree with the engine -- used where the
+                                               API (not the integrator) has just rewritten the state */
+  {
+    s->ref.debounce_ct = s->debounce_ct;
+    s->ref.debounce_state = s->debounce_state;
+    s->ref.debounce_change = s->debounce_change;
+    s->ref.event_ct_up = s->event_ct_up;
+    s->ref.event_ct_down = s->event_ct_down;
+  }
+
+
+  static char sched_shadow_differ0(unsigned char field, unsigned int engine, unsigned int reference,
+                                   char ident, unsigned long when)
+  {
+    if (engine == reference)
+      {
+        return 0;
+      }
+
+    if (!sched_shadow_latched)    /* keep only the FIRST divergence -- later ones are usually fallout */
+      {
+        sched_shadow_first.ms = when;
+        sched_shadow_first.ident = ident;
+        sched_shadow_first.field = field;
+        sched_shadow_first.engine = engine;
+        sched_shadow_first.reference = reference;
+        sched_shadow_latched = 1;
+      }
+
+    return 1;
+  }
+
+
+  static char sched_shadow_compare0(sched *s, unsigned long when)   /* returns HIGH on any divergence */
+  {
+    char bad = 0;
+
+    /* debounce_ct is only meaningful as a signed count, so compare it as one */
+    bad |= sched_shadow_differ0(SCHED_DIV_CT, (unsigned char)s->debounce_ct,
+                                (unsigned char)s->ref.debounce_ct, s->id, when);
+    bad |= sched_shadow_differ0(SCHED_DIV_STATE, s->debounce_state, s->ref.debounce_state, s->id, when);
+    bad |= sched_shadow_differ0(SCHED_DIV_CHANGE, s->debounce_change, s->ref.debounce_change, s->id, when);
+    bad |= sched_shadow_differ0(SCHED_DIV_UP, s->event_ct_up, s->ref.event_ct_up, s->id, when);
+    bad |= sched_shadow_differ0(SCHED_DIV_DOWN, s->event_ct_down, s->ref.event_ct_down, s->id, when);
+
+    return bad;
+  }
+
+
+  static void sched_shadow_step0(sched *s, unsigned char level, char debounce, unsigned long when)
+  {
+    sched_ref_debounce0(&(s->ref), level, debounce);
+    sched_shadow_compare0(s, when);
+  }
+#endif
+
+
+#if SCHED_TRACE
+#define SCHED_TRACE_MASK (SCHED_TRACE_SIZE - 1)
+
+  static unsigned char sched_trace_buf[SCHED_TRACE_SIZE];
+  static volatile unsigned char sched_trace_head = 0;     /* next byte to be written */
+  static volatile unsigned char sched_trace_tail = 0;     /* first byte of oldest record */
+  static volatile unsigned char sched_trace_used = 0;
+  static volatile unsigned long sched_trace_lastms = 0;   /* time of newest record */
+  static volatile unsigned long sched_trace_basems = 0;   /* time the oldest record's delta counts from */
+  static volatile unsigned char sched_trace_dropped = 0;
+  static volatile unsigned char sched_trace_isrmax = 0;
+
+
+  static unsigned char sched_trace_reclen0(unsigned char idx, unsigned long *dt)
+  /* length of the record starting at idx, and its time delta -- only call with interrupts off */
+  {
+    unsigned char len = 1;     /* header */
+    unsigned char shift = 0;
+    unsigned char b;
+    unsigned long v = 0;
+
+    do
+      {
+        b = sched_trace_buf[(idx + len) & SCHED_TRACE_MASK];
+        v |= ((unsigned long)(b & 0x7F)) << shift;
+        shift += 7;
+        len++;
+      }
+    while (b & 0x80);
+
+    *dt = v;
+    return len + 1;            /* every record type carries one payload byte */
+  }
+
+
+  static void sched_trace_put0(unsigned char hdr, unsigned char payload, unsigned long now)
+  /* add one record, overwriting the oldest if the ring is full -- callable from the ISR or the event loop */
+  {
+    unsigned char rec[7];
+    unsigned char len = 0;
+    unsigned char i;
+    unsigned long dt;
+    unsigned char oldSREG;
+
+    oldSREG = SREG;
+    cli();
+
+    if ((long)(now - sched_trace_lastms) < 0)
+      {
+        now = sched_trace_lastms;    /* an ISR record slipped in after the caller read millis() */
+      }
+
+    dt = now - sched_trace_lastms;
+    sched_trace_lastms = now;
+
+    rec[len++] = hdr;
+
+    do
+      {
+        rec[len] = dt & 0x7F;
+        dt >>= 7;
+
+        if (dt)
+          {
+            rec[len] |= 0x80;
+          }
+
+        len++;
+      }
+    while (dt);
+
+    rec[len++] = payload;
+
+    while ((SCHED_TRACE_SIZE - sched_trace_used) < len)   /* full -- drop whole records from the old end */
+      {
+        i = sched_trace_reclen0(sched_trace_tail, &dt);
+        sched_trace_tail = (sched_trace_tail + i) & SCHED_TRACE_MASK;
+        sched_trace_used -= i;
+        sched_trace_basems += dt;     /* the new oldest record counts from the one just dropped */
+
+        if (sched_trace_dropped < 255)
+          {
+            sched_trace_dropped++;
+          }
+      }
+
+    for (i=0; i<len; i++)
+      {
+        sched_trace_buf[sched_trace_head] = rec[i];
+        sched_trace_head = (sched_trace_head + 1) & SCHED_TRACE_MASK;
+      }
+
+    sched_trace_used += len;
+
+    SREG = oldSREG;
+  }
+#endif
+
+
+#if SCHED_EDGE_TIMES
+  /* Edge timing for one pin, after the integrator has seen the sample -- oldstate is the debounced
+     level before it.  Kept out of sched_debounce0() so the integrator itself stays comparable with
+     the reference. */
+
+  static void sched_edgetime0(sched *s, unsigned char level, unsigned char oldstate, unsigned long now)   /* now -- a stamp */
+  {
+    if (s->debounce_state != oldstate)
+      {
+        /* transition confirmed -- with debouncing off it may also be the first raw sample */
+        if (s->raw_quiet == 0xFF)
+          {
+            s->rawedge_st = now;
+          }
+
+        s->edge_st = now;
+        s->raw_quiet = 0xFF;
+      }
+    else if (level != s->debounce_state)
+      {
+        /* raw change not (yet) confirmed -- remember when the first one of the run came */
+        if (s->raw_quiet == 0xFF)
+          {
+            s->rawedge_st = now;
+          }
+
+        s->raw_quiet = 0;
+      }
+    else if (s->raw_quiet != 0xFF)
+      {
+        s->raw_quiet++;
+
+        if (s->raw_quiet >= SCHED_RAW_QUIET)
+          {
+            s->raw_quiet = 0xFF;    /* it was only a glitch */
+          }
+      }
+  }
+#endif
+
+
+  /* Debounce integrator for one pin -- simulate a low-pass filter into a Schmitt trigger.  level is the
+     instantaneous sample; debounce = 0 forces the output to follow the sample directly (0 ms recurring
+     period).  This is the code to optimize: with SCHED_SHADOW_CHECK on, every live call is followed by
+     the reference above on the same sample, so any change in behaviour shows up at the first sample
+     where it matters. */
+
+  static void sched_debounce0(sched *s, unsigned char level, char debounce)
+  {
+    if (level)
+      {
+        /* if pin is HIGH... */
+        if (!debounce)
+          {
+            s->debounce_ct = sched_db_max;  /* Immediately force Schmitt trigger action */
+          }
+        else
+          {
+            /* if instantaneously HIGH, count up to simulate low-pass filter */
+            s->debounce_ct++;
+          }
+
+        /* simulate Schmitt trigger (hysteresis) */
+        if (s->debounce_ct > sched_db_up)
+          {
+            s->debounce_ct = sched_db_max;  /* Schmitt trigger action */
+
+            if (!(s->debounce_state))    /* if it WAS LOW... */
+              {
+                s->debounce_change++;     /* indicate changed state until checked by user */
+                s->event_ct_up++;         /* indicate up count until reset by user */
+              }
+
+            s->debounce_state = HIGH;   /* force state at this threshold */
+          }
+      }
+    else
+      {
+        /* if pin is LOW... */
+
+        if (!debounce)
+          {
+            s->debounce_ct = DEBOUNCE_THRESH_BOTTOM;  /* Immediately force Schmitt trigger action */
+          }
+        else
+          {
+            /* if instantaneously LOW, count down to simulate low-pass filter */
+            s->debounce_ct--;
+          }
+
+        /* simulate Schmitt trigger (hysteresis) */
+        if (s->debounce_ct < sched_db_down)
+          {
+            s->debounce_ct = DEBOUNCE_THRESH_BOTTOM;  /* Schmitt trigger action */
+
+            if (s->debounce_state)     /* if it WAS HIGH... */
+              {
+                s->debounce_change++;     /* indicate changed state until checked by user */
+                s->event_ct_down++;       /* indicate down count until reset by user */
+              }
+
+            s->debounce_state = LOW;   /* force state at this threshold */
+          }
+      }
+
+  }
+
+
   /* Notes on use of sched_list_init():
      In the setup() function (ARDUINO) at the beginning of the execution of a program,
      call sched_list_init() to enable all internals for the scheduler.  If a positive number
@@ -135,8 +692,25 @@ extern "C"    /* begin C-only code */
         schedlist[i].event_ct_down = 0;
         schedlist[i].debounce_change = 0;
         schedlist[i].debounce_state = LOW;
+        schedlist[i].prio = SCHED_PRIO_NORMAL;
+        schedlist[i].count_n = 0;
+#if SCHED_TWO_PHASE
+        schedlist[i].phase2 = 0;
+#endif
+#if SCHED_EDGE_TIMES
+        schedlist[i].rawedge_st = 0;
+        schedlist[i].edge_st = 0;
+        schedlist[i].raw_quiet = 0xFF;
+#endif
+#if SCHED_SHADOW_CHECK
+        sched_shadow_sync0(&schedlist[i]);
+#endif
       }
 
+#if SCHED_SHADOW_CHECK
+    sched_shadow_latched = 0;
+#endif
+
     if (num_analogs_toscan > (MAX_ANALOG_PIN+1))
       {
         num_analogs_toscan = MAX_ANALOG_PIN + 1;
@@ -147,12 +721,78 @@ extern "C"    /* begin C-only code */
     for (i=0; i<=MAX_ANALOG_PIN; i++)
       {
         sched_analoglist[i] = 0;
+        sched_analog_lo[i] = SCHED_ANALOG_LO;
+        sched_analog_hi[i] = SCHED_ANALOG_HI;
       }
 
+    sched_analog_levels = 0;
+    sched_ladder_ch = 0xFF;
+    sched_ladder_levels = 0xFF;
+
     sched_current_analog = 0;
     sched_count = 0;
+    sched_bucket_n[0] = 0;
+    sched_bucket_n[1] = 0;
+    sched_bucket_n[2] = 0;
+    sched_bucket_crit = 0;
+
+#ifdef SCHED_T1_PIN
+    if (sched_t1_ident >= 0)
+      {
+        TCCR1B = 0;     /* stop counting */
+        sched_t1_ident = -1;
+      }
+#endif
+
+#if SCHED_ADC_AUTO && defined(ADCSRA) && defined(ADMUX)
+    /* Start conversions from the Timer0 overflow (ADTS 100), just ahead of this ISR's COMPB */
+    sched_adc_busy = 0xFF;
+    sched_adc_prev = 0xFF;
+    sched_adc_mux = 0;
+    ADMUX = (0x40) | (0x00);
+    ADCSRB = (ADCSRB & ~((1<<ADTS2) | (1<<ADTS1) | (1<<ADTS0))) | (1<<ADTS2);
+    ADCSRA |= (1<<ADATE);
+#endif
+    sched_defer_next = 0;
+    sched_meas_used = 0;
+
+    for (i=0; i<SCHED_MEASURE_MAX; i++)
+      {
+        sched_measlist[i].ident = -1;
+      }
+
+    sched_bnc_used = 0;
+
+    for (i=0; i<SCHED_BOUNCE_MAX; i++)
+      {
+        sched_bnclist[i].ident = -1;
+      }
+
+    sched_life_used = 0;
+
+    for (i=0; i<SCHED_LIFETIME_MAX; i++)
+      {
+        sched_lifelist[i].ident = -1;
+      }
+
+    sched_idle_used = 0;
+
+    for (i=0; i<SCHED_IDLE_MAX; i++)
+      {
+        sched_idlelist[i].ident = -1;
+      }
+
+    sched_stage_count = 0;
+    sched_stage_ready = 0;
     sched_priorms = millis();
+    sched_clear_stats();
 
+#if SCHED_BACKEND_COOP
+    /* Timer0 is left exactly as the core set it up -- sched_service() in the user event loop
+       drives the ticks instead of the COMPB interrupt */
+    sched_service_ms = sched_priorms;
+    sched_coop_us = micros();
+#else
     /* NOW enable the ISR to handle background scheduling processes. */
     if (!sched_ISR_installed)  /* only do this once per program run */
       {
@@ -177,7 +817,11 @@ extern "C"    /* begin C-only code */
            for the life of the program.
            */
 
-        OCR0B = 4;    /* about 4*4 micoseconds delay in firing COMPB interrupt after OVF */
+        OCR0B = SCHED_PHASE1_OCR;    /* about 4*4 micoseconds delay in firing COMPB interrupt after OVF */
+
+#if SCHED_TWO_PHASE
+        OCR0A = SCHED_PHASE2_OCR;    /* the mid-period sample pass -- see TIMER0_COMPA below */
+#endif
 
         /* turn on CTC mode */
         TCCR0A |= (1 << WGM01);
@@ -190,18 +834,25 @@ extern "C"    /* begin C-only code */
         /* Assume ATtiny85 */
         /* enable timer compare interrupt */
         TIMSK |= (1 << OCIE0B);
+#if SCHED_TWO_PHASE
+        TIMSK |= (1 << OCIE0A);
+#endif
         /* enable Timer0 overflow interrupt */
         TIMSK |= (1<<TOIE0);
 #else
         /* Assume Arduino */
         /* enable timer compare interrupt */
         TIMSK0 |= (1 << OCIE0B);
+#if SCHED_TWO_PHASE
+        TIMSK0 |= (1 << OCIE0A);
+#endif
         /* enable Timer0 overflow interrupt */
         TIMSK0 |= (1<<TOIE0);
 #endif
 
         sched_ISR_installed = 1;
       }
+#endif
 
     sched_initialized = 1;
   }
@@ -225,298 +876,1307 @@ extern "C"    /* begin C-only code */
   */
 
 
-  char sched_event(char ident, char recur, unsigned long ms)
-  {
-    char i;
-    char pos = -1;
-    unsigned long timems;
-
-    timems = millis();
+  /* Instantaneous level of a monitored pin -- digital, or analog virtual */
 
-    /* see if this event id is already in list */
-    for (i=0; i<sched_count; i++)
+  static unsigned char sched_sample0(unsigned char id)
+  {
+    if (id >= SCHED_LADDER_BASE)
       {
-        if (ident == schedlist[i].id)
-          {
-            pos = i;
-          }
+        return (sched_ladder_levels >> (id - SCHED_LADDER_BASE)) & 1;
       }
 
-    if (pos < 0)   /* NOT already in list */
+    if (id >= SCHED_ANALOG_BASE)
       {
-        /* No existing event with this id was found. If there is room, add another id to the list. */
-        if (sched_count < MAX_SCHED)
-          {
-            pos = sched_count;
-            sched_count++;
-          }
+        return (sched_analog_levels >> (id - SCHED_ANALOG_BASE)) & 1;
       }
 
-    if (pos >= 0)
+    return digitalRead(id);
+  }
+
+
+  /* Schmitt trigger on one analog reading -- between the thresholds the channel keeps its level */
+
+  static void sched_analog_level0(unsigned char ch, unsigned int val)
+  {
+    if (val > sched_analog_hi[ch])
+      {
+        sched_analog_levels |= (1 << ch);
+      }
+    else if (val < sched_analog_lo[ch])
+      {
+        sched_analog_levels &= ~(1 << ch);
+      }
+  }
+
+
+  /* Which ladder button one reading of the ladder channel shows -- the lookup gives the band at the
+     bottom of the reading's 32-count cell, then the walk steps over the bounds inside the cell: one at
+     most when the bounds are 32 counts or more apart, never more than sched_ladder_n when they are
+     packed closer.  Sets that button's level LOW and the rest HIGH. */
+
+  static void sched_ladder_level0(unsigned int val)
+  {
+    unsigned char b;
+
+    b = sched_ladder_lut[val >> SCHED_LADDER_SHIFT];
+
+    while ((b < sched_ladder_n) && (val >= sched_ladder_bounds[b]))
+      {
+        b++;
+      }
+
+    sched_ladder_levels = (b < sched_ladder_n) ? ~(1 << b) : 0xFF;   /* past the last band -- none pressed */
+  }
+
+
+  /* Fill in one slot of either list as a newly set up event -- a pin starts out debounced at its
+     present level. */
+
+  static void sched_slot_init0(sched *s, char ident, char recur, unsigned long ms, unsigned long timems)
+  {
+#if SCHED_SHADOW_CHECK
+    unsigned char oldSREG;
+#endif
+
+    s->id        =    ident;
+    s->schedtime =    ms + timems;
+    s->schedms   =    ms;
+    s->recurring =    recur;
+    s->event_ct_up = 0;
+    s->event_ct_down = 0;
+    s->count_n = 0;
+    s->active = 1;
+
+    if ((!recur) && (ms == 0))  /* this specifies that timer should be turned off */
+      {
+        s->active = 0;
+      }
+
+    if (SCHED_IS_PIN(s->id)) /* if this is a monitored pin... */
       {
-        schedlist[pos].id        =    ident;
-        schedlist[pos].schedtime =    ms + timems;
-        schedlist[pos].schedms   =    ms;
-        schedlist[pos].recurring =    recur;
-        schedlist[pos].event_ct_up = 0;
-        schedlist[pos].event_ct_down = 0;
-        schedlist[pos].active = 1;
+        s->laststate = sched_sample0(s->id);
 
-        if ((!recur) && (ms == 0))  /* this specifies that timer should be turned off */
+        if (s->laststate)
           {
-            schedlist[pos].active = 0;
+            /* if pin is HIGH... */
+            s->debounce_ct = sched_db_max;  /* Immediately force Schmitt trigger action */
+            s->debounce_change = 0;
+            s->debounce_state = HIGH;
           }
-
-        if ((schedlist[pos].id >= 0) && (schedlist[pos].id <= MAX_DIGITAL_PIN)) /* if this is a monitored pin... */
+        else
           {
-            schedlist[pos].laststate = digitalRead(schedlist[pos].id);
-
-            if (schedlist[pos].laststate)
-              {
-                /* if pin is HIGH... */
-                schedlist[pos].debounce_ct = DEBOUNCE_THRESH_MAX;  /* Immediately force Schmitt trigger action */
-                schedlist[i].debounce_change = 0;
-                schedlist[i].debounce_state = HIGH;
-              }
-            else
-              {
-                schedlist[pos].debounce_ct = DEBOUNCE_THRESH_BOTTOM;  /* Immediately force Schmitt trigger action */
-                schedlist[i].debounce_change = 0;
-                schedlist[i].debounce_state = LOW;
-              }
+            s->debounce_ct = DEBOUNCE_THRESH_BOTTOM;  /* Immediately force Schmitt trigger action */
+            s->debounce_change = 0;
+            s->debounce_state = LOW;
           }
 
-        return 1;
-      }
+#if SCHED_EDGE_TIMES
+        s->raw_quiet = 0xFF;
+        s->rawedge_st = sched_stamp();
+        s->edge_st = s->rawedge_st;
+#endif
 
-    /* indicate that no match to event was found */
-    return 0;
+#if SCHED_SHADOW_CHECK
+        oldSREG = SREG;
+        cli();
+        sched_shadow_sync0(s);   /* registration is an input, not something to check */
+        SREG = oldSREG;
+#endif
+      }
   }
 
 
-  /* Cancel the timout for an identified scheduled event, while leaving its entry in place in the
-     schedule list.
-  */
+  /* Position of an ident in the live list, -1 if none.  A caller outside the ISR must hold
+     sched_api_busy from before this until it is done with the position, or a swap in between could
+     leave it pointing into the other list. */
 
-  char sched_cancel(char ident)
+  static char sched_find0(char ident)
   {
-    return sched_event(ident,0,0L);
+    char i;
+    char pos = -1;
+
+    for (i=0; i<sched_count; i++)
+      {
+        if (ident == schedlist[i].id)
+          {
+            pos = i;
+          }
+      }
+
+    return pos;
   }
 
 
-  static char sched_check0(char pos)     /* individual automated check of one schedule in list -- must be called
-                                        from within sched_background() more often than once per ms */
+  /* Sort the live list's pins into the rate buckets -- with interrupts off, as the ISR walks them */
+
+  static void sched_bucket_build0(void)
   {
-    unsigned long timems;
-    char debounce = 1;
+    char i;
+    unsigned char b;
+    unsigned char oldSREG;
 
-    timems = millis();
+    oldSREG = SREG;
+    cli();
 
-    if ((pos < 0) || (pos >= sched_count))
+    sched_bucket_n[0] = 0;
+    sched_bucket_n[1] = 0;
+    sched_bucket_n[2] = 0;
+
+    /* critical pins every tick whatever their period... */
+    for (i=0; i<sched_count; i++)
       {
-        return 0;
+        if (SCHED_IS_PIN(schedlist[i].id) && (schedlist[i].prio == SCHED_PRIO_CRITICAL))
+          {
+            sched_bucket[0][sched_bucket_n[0]++] = i;
+          }
       }
 
-    if (schedlist[pos].active)
+    sched_bucket_crit = sched_bucket_n[0];
+
+    /* ...the rest by period */
+    for (i=0; i<sched_count; i++)
       {
-        if (schedlist[pos].schedtime <= timems)
+        if (SCHED_IS_PIN(schedlist[i].id) && (schedlist[i].prio != SCHED_PRIO_CRITICAL))
           {
-            /* Time is up! */
-            if (schedlist[pos].recurring)
+            if (schedlist[i].schedms >= sched_bucket_ms[2])
               {
-                /* remain active and bump to next scheduled time */
-                schedlist[pos].schedtime = (schedlist[pos].schedtime + schedlist[pos].schedms);
-
-                if (schedlist[pos].schedms == 0)
-                  {
-                    debounce = 0;
-                    schedlist[pos].schedtime++;     /* force schedule time to next ms */
-                  }
+                b = 2;
+              }
+            else if (schedlist[i].schedms >= sched_bucket_ms[1])
+              {
+                b = 1;
               }
             else
               {
-                schedlist[pos].active = 0;
+                b = 0;
               }
 
-            if ((schedlist[pos].id >= 0) && (schedlist[pos].id <= MAX_DIGITAL_PIN)) /* if this is a monitored pin... */
+            sched_bucket[b][sched_bucket_n[b]++] = i;
+          }
+      }
+
+    sched_defer_next = 0;
+
+    SREG = oldSREG;
+  }
+
+
+  /* Where a recurring entry of a list should start counting from, so that it first expires within one
+     period of timems at the given phase (millis() modulo ms) -- or, for SCHED_PHASE_AUTO and a pin,
+     half way across the widest gap between the phases of the list's other pins with the same period
+     (entry skip is the one being set up, for ident).  Returns timems itself when there is nothing to
+     place. */
+
+  static unsigned long sched_phase0(sched *list, char count, char skip, char ident, char recur,
+                                    unsigned long ms, unsigned long phase, unsigned long timems)
+  {
+    unsigned long d;
+#if SCHED_STAGGER
+    char i;
+    char j;
+    unsigned long p;
+    unsigned long gap;
+    unsigned long widest = 0;
+#endif
+
+    if ((!recur) || (ms < 2))
+      {
+        return timems;
+      }
+
+    if (phase == SCHED_PHASE_AUTO)
+      {
+#if SCHED_STAGGER
+        /* only pin samples load the ISR -- a user timer still starts one period from now */
+        for (i=0; SCHED_IS_PIN(ident) && (i<count); i++)
+          {
+            if ((i == skip) || (!SCHED_IS_PIN(list[i].id)) || (!list[i].active) || (!list[i].recurring)
+                || (list[i].schedms != ms))
               {
-                schedlist[pos].laststate = digitalRead(schedlist[pos].id);
+                continue;
+              }
+
+            /* gap from this phase to the next one round the cycle -- the whole period if alone */
+            p = list[i].schedtime % ms;
+            gap = ms;
 
-                if (schedlist[pos].laststate)
+            for (j=0; j<count; j++)
+              {
+                if ((j == skip) || (j == i) || (!SCHED_IS_PIN(list[j].id)) || (!list[j].active)
+                    || (!list[j].recurring) || (list[j].schedms != ms))
                   {
-                    /* if pin is HIGH... */
-                    if (!debounce)
-                      {
-                        schedlist[pos].debounce_ct = DEBOUNCE_THRESH_MAX;  /* Immediately force Schmitt trigger action */
-                      }
-                    else
-                      {
-                        /* if instantaneously HIGH, count up to simulate low-pass filter */
-                        schedlist[pos].debounce_ct++;
-                      }
-
-                    /* simulate Schmitt trigger (hysteresis) */
-                    if (schedlist[pos].debounce_ct > DEBOUNCE_THRESH_UP)
-                      {
-                        schedlist[pos].debounce_ct = DEBOUNCE_THRESH_MAX;  /* Schmitt trigger action */
-
-                        if (!(schedlist[pos].debounce_state))    /* if it WAS LOW... */
-                          {
-                            schedlist[pos].debounce_change++;     /* indicate changed state until checked by user */
-                            schedlist[pos].event_ct_up++;         /* indicate up count until reset by user */
-                          }
-
-                        schedlist[pos].debounce_state = HIGH;   /* force state at this threshold */
-                      }
+                    continue;
                   }
-                else
+
+                d = ((list[j].schedtime % ms) + ms - p) % ms;
+
+                if ((d || (j > i)) && (d < gap))     /* of entries in step, only the first has a gap of 0 */
                   {
-                    /* if pin is LOW... */
-
-                    if (!debounce)
-                      {
-                        schedlist[pos].debounce_ct = DEBOUNCE_THRESH_BOTTOM;  /* Immediately force Schmitt trigger action */
-                      }
-                    else
-                      {
-                        /* if instantaneously LOW, count down to simulate low-pass filter */
-                        schedlist[pos].debounce_ct--;
-                      }
-
-                    /* simulate Schmitt trigger (hysteresis) */
-                    if (schedlist[pos].debounce_ct < DEBOUNCE_THRESH_DOWN)
-                      {
-                        schedlist[pos].debounce_ct = DEBOUNCE_THRESH_BOTTOM;  /* Schmitt trigger action */
-
-                        if (schedlist[pos].debounce_state)     /* if it WAS HIGH... */
-                          {
-                            schedlist[pos].debounce_change++;     /* indicate changed state until checked by user */
-                            schedlist[pos].event_ct_down++;       /* indicate down count until reset by user */
-                          }
-
-                        schedlist[pos].debounce_state = LOW;   /* force state at this threshold */
-                      }
+                    gap = d;
                   }
               }
 
-            return 1;
+            if (gap > widest)
+              {
+                widest = gap;
+                phase = p + (gap / 2);
+              }
+          }
+#else
+        (void)list;
+        (void)count;
+        (void)skip;
+        (void)ident;
+#endif
+
+        if (phase == SCHED_PHASE_AUTO)
+          {
+            return timems;
           }
       }
 
-    /* indicate that no match to event was found */
-    return 0;
+    d = ((phase % ms) + ms - (timems % ms)) % ms;
+
+    if (!d)
+      {
+        d = ms;
+      }
+
+    return timems + d - ms;
   }
 
 
-  static char sched_pin_test0(char pos, char level, char delta)     /* individual check of one debounced pin change in list */
+  static char sched_event0(char ident, char recur, unsigned long ms, unsigned long phase)
   {
-    char changes;
+    char pos;
+    char found = 0;
+    unsigned long timems;
 
-    if ((pos < 0) || (pos >= sched_count))
+    timems = millis();
+
+    sched_api_busy++;      /* no swap until we are done with pos */
+    pos = sched_find0(ident);
+
+    if (pos >= 0)
       {
-        return 0;
+        sched_slot_init0(&schedlist[pos], ident, recur, ms,
+                         sched_phase0(schedlist, sched_count, pos, ident, recur, ms, phase, timems));
+        sched_bucket_build0();    /* the period may have changed */
+        found = 1;
       }
 
-    if (schedlist[pos].active)
+    /* No existing event with this id was found. If there is room, add another id to the list --
+       complete before the ISR is allowed to see it. */
+    else if (sched_count < MAX_SCHED)
+      {
+        schedlist[sched_count].prio = SCHED_PRIO_NORMAL;
+#if SCHED_TWO_PHASE
+        schedlist[sched_count].phase2 = 0;
+#endif
+        sched_slot_init0(&schedlist[sched_count], ident, recur, ms,
+                         sched_phase0(schedlist, sched_count, -1, ident, recur, ms, phase, timems));
+        sched_count++;
+        sched_bucket_build0();
+        found = 1;
+      }
+
+    sched_api_busy--;
+
+    /* zero if no match to event was found, and no room for it */
+    return found;
+  }
+
+
+  char sched_event(char ident, char recur, unsigned long ms)
+  {
+    return sched_event0(ident, recur, ms, SCHED_PHASE_AUTO);
+  }
+
+
+  char sched_event_phase(char ident, unsigned long ms, unsigned long phase)
+  {
+    return sched_event0(ident, 1, ms, phase);
+  }
+
+
+  /* Staged reconfiguration -- see glf_scheduler.h */
+
+  char sched_stage_begin(unsigned char num_analogs_toscan, char copy)
+  {
+    char i;
+
+    if (sched_stage_ready)
       {
-        changes = schedlist[pos].debounce_change;
-        schedlist[pos].debounce_change = 0;
+        return 0;     /* previous commit not yet swapped in */
+      }
+
+    if (num_analogs_toscan > (MAX_ANALOG_PIN+1))
+      {
+        num_analogs_toscan = MAX_ANALOG_PIN + 1;
+      }
 
-        if (!delta)      /* special indicator to report raw debounced level only, not changes in level */
+    sched_stage_analogs = num_analogs_toscan;
+    sched_stage_count = 0;
+
+    if (copy)
+      {
+        for (i=0; i<sched_count; i++)
           {
-            return schedlist[pos].debounce_state;
+            sched_stage_event(schedlist[i].id, schedlist[i].recurring,
+                              schedlist[i].active ? schedlist[i].schedms : 0);
+            schedstage[i].prio = schedlist[i].prio;
+#if SCHED_TWO_PHASE
+            schedstage[i].phase2 = schedlist[i].phase2;
+#endif
           }
+      }
+
+    return 1;
+  }
+
+
+  char sched_stage_event(char ident, char recur, unsigned long ms)
+  {
+    char i;
+    char pos = -1;
+    unsigned long timems;
+
+    if (sched_stage_ready)
+      {
+        return 0;
+      }
 
-        if (changes)
+    for (i=0; i<sched_stage_count; i++)
+      {
+        if (ident == schedstage[i].id)
           {
-            /* Something happened on pin -- see if it matches expected level */
-            if (level)
-              {
-                if (schedlist[pos].debounce_state)
-                  {
-                    return 1;
-                  }
-              }
+            pos = i;
+          }
+      }
 
-            else
-              {
-                if (!(schedlist[pos].debounce_state))
-                  {
-                    return 1;
-                  }
-              }
+    if (pos < 0)
+      {
+        if (sched_stage_count >= MAX_SCHED)
+          {
+            return 0;
           }
+
+        pos = sched_stage_count++;
+        schedstage[pos].prio = SCHED_PRIO_NORMAL;
+#if SCHED_TWO_PHASE
+        schedstage[pos].phase2 = 0;
+#endif
       }
 
-    /* indicate that no pin change event was found */
-    return 0;
+    timems = millis();
+    sched_slot_init0(&schedstage[pos], ident, recur, ms,
+                     sched_phase0(schedstage, sched_stage_count, pos, ident, recur, ms, SCHED_PHASE_AUTO,
+                                  timems));
+    return 1;
   }
 
 
-  unsigned int sched_analogread(unsigned char pin)   /* manual asynchronous read of analog port from preset buffer
-                                   filled in by background process */
+  char sched_stage_drop(char ident)
   {
-    if (pin > sched_num_analogs)
+    char i;
+    char found = 0;
+
+    if (sched_stage_ready)
       {
         return 0;
       }
 
-    /* because this is filled in by ISR, it should be double-checked for change across atomic boundaries */
+    for (i=0; i<sched_stage_count; i++)
+      {
+        if (found)
+          {
+            schedstage[i-1] = schedstage[i];
+          }
+        else if (ident == schedstage[i].id)
+          {
+            found = 1;
+          }
+      }
 
-    return sched_analoglist[pin];
+    if (found)
+      {
+        sched_stage_count--;
+      }
+
+    return found;
   }
 
 
-  char sched_check(char ident)   /* Manual asynchronous check of ID'd schedule --
-                                 return value HIGH means timeout was reached. */
+  /* Carry the live state of one slot into its staged replacement -- in the ISR, at the swap */
+
+  static void sched_stage_carry0(sched *to, sched *from)
+  {
+    if (SCHED_IS_PIN(to->id))
+      {
+        /* a pin keeps its integrator, level, unread change and counts -- no sample is lost */
+        to->laststate = from->laststate;
+        to->debounce_ct = from->debounce_ct;
+        to->debounce_state = from->debounce_state;
+        to->debounce_change = from->debounce_change;
+        to->event_ct_up = from->event_ct_up;
+        to->event_ct_down = from->event_ct_down;
+        to->count_n = from->count_n;
+        to->count_flags = from->count_flags;
+#if SCHED_EDGE_TIMES
+        to->rawedge_st = from->rawedge_st;
+        to->edge_st = from->edge_st;
+        to->raw_quiet = from->raw_quiet;
+#endif
+#if SCHED_SHADOW_CHECK
+        to->ref = from->ref;
+#endif
+      }
+
+    if (to->active && from->active && (to->recurring == from->recurring) && (to->schedms == from->schedms))
+      {
+        /* timer settings unchanged -- keep its phase, or the rest of its countdown */
+        to->schedtime = from->schedtime;
+      }
+  }
+
+
+  /* Put the staged list in place of the live one -- in the ISR, before anything else in a tick (or in
+     sched_stage_commit() itself, before the ISR is running) */
+
+  static void sched_stage_swap0(void)
   {
     char i;
-    char pos = -1;
+    sched *t;
 
-    /* see if this event id is already in list */
-    for (i=0; i<sched_count; i++)
+    for (i=0; i<sched_stage_count; i++)
       {
-        if (ident == schedlist[i].id)
+        if (sched_stage_carry[i] >= 0)
           {
-            pos = i;
+            sched_stage_carry0(&schedstage[i], &schedlist[sched_stage_carry[i]]);
           }
       }
 
-    if (pos < 0)   /* NOT already in list */
+    if ((!sched_num_analogs) || (sched_current_analog >= sched_stage_analogs))
       {
-        /* No existing event with this id was found. */
-        return 0;
+        /* the conversion in flight (if any) is of a channel no longer scanned -- setting the
+           current channel past the end discards it and starts the new set from channel 0 */
+        sched_current_analog = sched_stage_analogs;
       }
 
-    return sched_check0(pos);
+    sched_num_analogs = sched_stage_analogs;
+
+    t = schedlist;
+    schedlist = schedstage;
+    schedstage = t;
+    sched_count = sched_stage_count;
+    sched_bucket_build0();
+
+    sched_stage_ready = 0;
   }
 
 
-  unsigned int sched_pin_event_count(char ident, char level, char reset)
-  /* Manual asynchronous check of ID'd schedule --
-  return value is count of defined transition events since last reset. */
+  void sched_stage_commit(void)
   {
     char i;
-    char pos = -1;
-    unsigned int val;
-    unsigned int holddown;
-    unsigned int holdup;
+    char j;
 
-    /* see if this event id is already in list */
-    for (i=0; i<sched_count; i++)
+    for (i=0; i<sched_stage_count; i++)
       {
-        if (ident == schedlist[i].id)
+        sched_stage_carry[i] = -1;
+
+        for (j=0; j<sched_count; j++)
           {
-            pos = i;
+            if (schedstage[i].id == schedlist[j].id)
+              {
+                sched_stage_carry[i] = j;
+              }
           }
       }
 
-    if (pos < 0)   /* NOT already in list */
+    if (!sched_initialized)
       {
-        /* No existing event with this id was found. */
-        return 0;
+        /* no ISR running yet -- nothing to synchronise with, so swap now, the same way it would */
+        sched_stage_swap0();
+        return;
       }
 
+    sched_stage_ready = 1;
+  }
+
+
+  char sched_stage_pending(void)
+  {
+    return sched_stage_ready;
+  }
+
+
+  /* Cancel the timout for an identified scheduled event, while leaving its entry in place in the
+     schedule list.
+  */
+
+  char sched_cancel(char ident)
+  {
+    return sched_event(ident,0,0L);
+  }
+
+
+#ifdef SCHED_T1_PIN
+  /* One tick of the firmware glitch filter for the Timer1 counted pin -- the first edge Timer1 counts
+     after a quiet holdoff is one event, and everything up to holdoff ms after it is bounce.  Costs
+     the same every tick however many edges there were. */
+
+  static char sched_t1_tick0(sched *s)
+  {
+    unsigned int now;
+    unsigned char oldSREG;
+
+    oldSREG = SREG;
+    cli();            /* 16-bit read through the shared TEMP register */
+    now = TCNT1;
+    SREG = oldSREG;
+
+    if (sched_t1_hold)
+      {
+        sched_t1_hold--;
+      }
+    else if (now != sched_t1_last)
+      {
+        s->event_ct_up++;
+        s->event_ct_down++;
+        sched_t1_last = now;
+        sched_t1_hold = sched_t1_holdoff;
+
+        return 1;
+      }
+
+    sched_t1_last = now;
+
+    return 0;
+  }
+
+
+  /* Edges counted by Timer1 since the last reset -- the reset moves the base instead of clearing
+     TCNT1, so an edge arriving as we reset is kept for the next lookup */
+
+  static unsigned int sched_t1_count0(char reset)
+  {
+    unsigned int now;
+    unsigned char oldSREG;
+
+    oldSREG = SREG;
+    cli();
+    now = TCNT1;
+
+    if (reset)
+      {
+        now -= sched_t1_base;
+        sched_t1_base += now;
+      }
+    else
+      {
+        now -= sched_t1_base;
+      }
+
+    SREG = oldSREG;
+
+    return now;
+  }
+#endif
+
+
+  /* Count threshold state, in count_flags with the level counted */
+#define SCHED_CNT_ARMED   0x00    /* waiting for the count to reach count_n */
+#define SCHED_CNT_READY   0x01    /* reached -- not yet seen by sched_pin_count_ready() */
+#define SCHED_CNT_SEEN    0x02    /* reached and seen -- rearms once the count drops back (is reset) */
+#define SCHED_CNT_STATE   0x03
+#define SCHED_CNT_LEVEL   0x80
+
+  /* After a pin's sample, compare its count with its threshold */
+
+  static void sched_count_flag0(sched *s)
+  {
+    unsigned int n;
+
+#ifdef SCHED_T1_PIN
+    if ((s->id == sched_t1_ident) && !sched_t1_holdoff)
+      {
+        n = sched_t1_count0(0);
+      }
+    else
+#endif
+    if (s->count_flags & SCHED_CNT_LEVEL)
+      {
+        n = s->event_ct_up;
+      }
+    else
+      {
+        n = s->event_ct_down;
+      }
+
+    if (n < s->count_n)
+      {
+        if ((s->count_flags & SCHED_CNT_STATE) == SCHED_CNT_SEEN)
+          {
+            s->count_flags &= ~SCHED_CNT_STATE;
+          }
+      }
+    else if ((s->count_flags & SCHED_CNT_STATE) == SCHED_CNT_ARMED)
+      {
+        s->count_flags |= SCHED_CNT_READY;
+      }
+  }
+
+
+  /* The stamp of right now, from within the ISR -- where the tick count is known to be current */
+
+  static inline unsigned long sched_stamp0(void)
+  {
+#if SCHED_BACKEND_COOP
+    unsigned long n;
+
+    /* no tick lines up with TCNT0 -- count the same units up from micros(), carrying the part unit
+       over, so the stamp runs the full 32 bits like the ISR's (micros() / 4 would wrap at 30) */
+    n = (micros() - sched_coop_us) / (64000000UL / F_CPU);
+    sched_coop_us += n * (64000000UL / F_CPU);
+    sched_coop_st += n;
+
+    return sched_coop_st;
+#else
+    return (sched_ticks << 8) | (unsigned char)(TCNT0 - SCHED_PHASE1_OCR);
+#endif
+  }
+
+
+  /* One sample of a measured pin into its gate, closing the gate when its time is up */
+
+  static void sched_measure0(sched *s, unsigned long timems)
+  {
+    sched_meas *m;
+    unsigned char i;
+    unsigned char level;
+
+    for (i=0; i<SCHED_MEASURE_MAX; i++)
+      {
+        m = &sched_measlist[i];
+
+        if (m->ident != (char)s->id)
+          {
+            continue;
+          }
+
+        level = (m->raw ? s->laststate : s->debounce_state);
+
+        m->samples++;
+
+        if (level)
+          {
+            m->high++;
+
+            if (!m->last)
+              {
+                m->last_st = sched_stamp0();
+
+                if (!m->edges)
+                  {
+                    m->first_st = m->last_st;
+                  }
+
+                m->edges++;
+              }
+          }
+
+        m->last = level;
+
+        if ((timems - m->start_ms) >= m->gate_ms)
+          {
+            m->pub_edges = m->edges;
+            m->pub_high = m->high;
+            m->pub_samples = m->samples;
+            m->pub_span = m->last_st - m->first_st;
+            m->pub_gates++;
+
+            m->edges = 0;
+            m->high = 0;
+            m->samples = 0;
+            m->start_ms = timems;
+          }
+      }
+  }
+
+
+  /* Count raw flips of a watched pin, and file them when the debounced level changes -- every flip
+     but the one the transition itself needs is a bounce (or noise the integrator rode out) */
+
+  static void sched_bounce0(sched *s, unsigned char oldraw, unsigned char oldstate)
+  {
+    sched_bnc *w;
+    unsigned char i;
+    unsigned char b;
+    unsigned char n;
+
+    for (i=0; i<SCHED_BOUNCE_MAX; i++)
+      {
+        w = &sched_bnclist[i];
+
+        if (w->ident != (char)s->id)
+          {
+            continue;
+          }
+
+        if (s->laststate != oldraw)
+          {
+            w->st.flips++;        /* the total counts every flip -- only the per-transition count saturates */
+
+            if (w->flips < 0xFF)
+              {
+                w->flips++;
+              }
+          }
+
+        if (s->debounce_state != oldstate)
+          {
+            n = (w->flips ? (w->flips - 1) : 0);
+            w->flips = 0;
+
+            if (n > w->st.worst)
+              {
+                w->st.worst = n;
+              }
+
+            for (b=0; n && (b < (SCHED_BOUNCE_BUCKETS - 1)); b++)
+              {
+                n >>= 1;
+              }
+
+            if (w->st.hist[b] < 0xFFFF)
+              {
+                w->st.hist[b]++;
+              }
+
+            w->st.transitions++;
+          }
+      }
+  }
+
+
+  /* Add to a counted pin's lifetime counts -- a low word which wraps leaves a carry for the reader
+     to fold into the high word */
+
+  static void sched_life0(sched *s, unsigned int up, unsigned int down)
+  {
+    sched_life *c;
+    unsigned char i;
+    unsigned int old;
+
+    for (i=0; i<SCHED_LIFETIME_MAX; i++)
+      {
+        c = &sched_lifelist[i];
+
+        if (c->ident != (char)s->id)
+          {
+            continue;
+          }
+
+        old = c->lo_up;
+        c->lo_up = old + up;
+
+        if ((c->lo_up < old) && (c->carry_up < 0xFF))
+          {
+            c->carry_up++;
+          }
+
+        old = c->lo_down;
+        c->lo_down = old + down;
+
+        if ((c->lo_down < old) && (c->carry_down < 0xFF))
+          {
+            c->carry_down++;
+          }
+      }
+  }
+
+
+  /* Whether an idle pin can be passed over this tick -- HIGH if the peek agrees with its last sample
+     and no full sample is due.  A peek which disagrees wakes the pin up, and the sample is taken now,
+     so the first edge is seen as soon as it would have been anyway. */
+
+  static char sched_idle0(sched *s)
+  {
+    sched_idle *c;
+    unsigned char i;
+
+    for (i=0; i<SCHED_IDLE_MAX; i++)
+      {
+        c = &sched_idlelist[i];
+
+        if (c->ident != (char)s->id)
+          {
+            continue;
+          }
+
+        if ((c->quiet < c->idle_after) || sched_meas_used)    /* a measurement wants every sample */
+          {
+            return 0;
+          }
+
+        if (((*c->reg & c->mask) ? HIGH : LOW) != s->laststate)
+          {
+            c->quiet = 0;
+            return 0;
+          }
+
+        if (--c->slow_left)
+          {
+            sched_stat.peeks++;
+            return 1;
+          }
+
+        c->slow_left = c->slow;
+        return 0;
+      }
+
+    return 0;
+  }
+
+
+  /* Count a full sample of an adaptive pin toward going idle -- any raw change, or an integrator not
+     yet agreeing with the pin, starts the count again */
+
+  static void sched_idle_quiet0(sched *s, unsigned char oldraw)
+  {
+    sched_idle *c;
+    unsigned char i;
+
+    for (i=0; i<SCHED_IDLE_MAX; i++)
+      {
+        c = &sched_idlelist[i];
+
+        if (c->ident != (char)s->id)
+          {
+            continue;
+          }
+
+        if ((s->laststate != oldraw) || (s->debounce_state != s->laststate))
+          {
+            c->quiet = 0;
+          }
+        else if (c->quiet < c->idle_after)
+          {
+            c->quiet++;
+            c->slow_left = c->slow;
+          }
+      }
+  }
+
+
+  /* Take one sample of a monitored pin and run it through the debounce integrator (or, with
+     debounce 0, straight through) */
+
+  static void sched_pin_step0(char pos, char debounce, unsigned long timems)
+  {
+    unsigned char oldstate;
+    unsigned char oldraw;
+#ifdef SCHED_T1_PIN
+    unsigned int now;
+    unsigned char oldSREG;
+#endif
+
+    if (sched_idle_used && sched_idle0(&schedlist[pos]))
+      {
+        return;     /* idle and unchanged */
+      }
+
+    sched_work++;
+
+#ifdef SCHED_T1_PIN
+    if (schedlist[pos].id == sched_t1_ident)    /* ...counted by Timer1, not sampled */
+      {
+        if (sched_t1_holdoff)
+          {
+            if (sched_t1_tick0(&schedlist[pos]) && sched_life_used)
+              {
+                sched_life0(&schedlist[pos], 1, 1);
+              }
+          }
+        else if (sched_life_used)     /* every edge counts -- take them from TCNT1 as they come */
+          {
+            oldSREG = SREG;
+            cli();
+            now = TCNT1;
+            SREG = oldSREG;
+
+            sched_life0(&schedlist[pos], now - sched_t1_last, now - sched_t1_last);
+            sched_t1_last = now;
+          }
+
+        if (schedlist[pos].count_n)
+          {
+            sched_count_flag0(&schedlist[pos]);
+          }
+
+        return;
+      }
+#endif
+    oldraw = schedlist[pos].laststate;
+    schedlist[pos].laststate = sched_sample0(schedlist[pos].id);
+    oldstate = schedlist[pos].debounce_state;
+    sched_debounce0(&schedlist[pos], schedlist[pos].laststate, debounce);
+#if SCHED_SHADOW_CHECK
+    sched_shadow_step0(&schedlist[pos], schedlist[pos].laststate, debounce, timems);
+#endif
+#if SCHED_EDGE_TIMES
+    sched_edgetime0(&schedlist[pos], schedlist[pos].laststate, oldstate, sched_stamp0());
+#endif
+#if SCHED_TRACE
+    if (schedlist[pos].debounce_state != oldstate)
+      {
+        sched_trace_put0(SCHED_TRC_EDGE | schedlist[pos].debounce_state, schedlist[pos].id, timems);
+      }
+#endif
+
+    if (schedlist[pos].count_n)
+      {
+        sched_count_flag0(&schedlist[pos]);
+      }
+
+    if (sched_meas_used)
+      {
+        sched_measure0(&schedlist[pos], timems);
+      }
+
+    if (sched_bnc_used)
+      {
+        sched_bounce0(&schedlist[pos], oldraw, oldstate);
+      }
+
+    if (sched_life_used && (schedlist[pos].debounce_state != oldstate))
+      {
+        sched_life0(&schedlist[pos], schedlist[pos].debounce_state, !schedlist[pos].debounce_state);
+      }
+
+    if (sched_idle_used)
+      {
+        sched_idle_quiet0(&schedlist[pos], oldraw);
+      }
+  }
+
+
+  static char sched_check0(char pos)     /* individual automated check of one schedule in list -- must be called
+                                        from within sched_background() more often than once per ms */
+  {
+    unsigned long timems;
+    char debounce = 1;
+
+    timems = millis();
+
+    if ((pos < 0) || (pos >= sched_count))
+      {
+        return 0;
+      }
+
+    if (schedlist[pos].active)
+      {
+        if (schedlist[pos].schedtime <= timems)
+          {
+            /* Time is up! */
+            if (schedlist[pos].recurring)
+              {
+                /* remain active and bump to next scheduled time */
+                schedlist[pos].schedtime = (schedlist[pos].schedtime + schedlist[pos].schedms);
+
+                if (schedlist[pos].schedms == 0)
+                  {
+                    debounce = 0;
+                    schedlist[pos].schedtime++;     /* force schedule time to next ms */
+                  }
+                else if (SCHED_IS_PIN(schedlist[pos].id) && (schedlist[pos].schedtime <= timems))
+                  {
+                    /* a pin seen a whole period late (its bucket visit put off, or ticks lost) drops
+                       the samples it missed, in whole periods so it keeps its phase -- rather than
+                       taking one on every visit until it has caught up */
+                    schedlist[pos].schedtime += ((timems - schedlist[pos].schedtime) / schedlist[pos].schedms + 1)
+                                                * schedlist[pos].schedms;
+                  }
+              }
+            else
+              {
+                schedlist[pos].active = 0;
+              }
+
+            if (SCHED_IS_PIN(schedlist[pos].id)) /* if this is a monitored pin... */
+              {
+                sched_pin_step0(pos, debounce, timems);
+              }
+#if SCHED_TRACE
+            else
+              {
+                sched_trace_put0(SCHED_TRC_TIMER, schedlist[pos].id, timems);
+              }
+#endif
+
+            return 1;
+          }
+      }
+
+    /* indicate that no match to event was found */
+    return 0;
+  }
+
+
+  static char sched_change0(sched *s, char level, char delta)    /* consume and test the change flag of one pin */
+  {
+    char changes;
+
+    changes = s->debounce_change;
+    s->debounce_change = 0;
+#if SCHED_SHADOW_CHECK
+    s->ref.debounce_change = 0;    /* the reference saw the same check */
+#endif
+
+    if (!delta)      /* special indicator to report raw debounced level only, not changes in level */
+      {
+        return s->debounce_state;
+      }
+
+    if (changes)
+      {
+        /* Something happened on pin -- see if it matches expected level */
+        if (level)
+          {
+            if (s->debounce_state)
+              {
+                return 1;
+              }
+          }
+
+        else
+          {
+            if (!(s->debounce_state))
+              {
+                return 1;
+              }
+          }
+      }
+
+    return 0;
+  }
+
+
+  static char sched_pin_test0(char pos, char level, char delta)     /* individual check of one debounced pin change in list */
+  {
+    if ((pos < 0) || (pos >= sched_count))
+      {
+        return 0;
+      }
+
+    if (schedlist[pos].active)
+      {
+        return sched_change0(&schedlist[pos], level, delta);
+      }
+
+    /* indicate that no pin change event was found */
+    return 0;
+  }
+
+
+  unsigned int sched_analogread(unsigned char pin)   /* manual asynchronous read of analog port from preset buffer
+                                   filled in by background process */
+  {
+    if (pin > sched_num_analogs)
+      {
+        return 0;
+      }
+
+    /* because this is filled in by ISR, it should be double-checked for change across atomic boundaries */
+
+    return sched_analoglist[pin];
+  }
+
+
+  char sched_analog_pin(unsigned char ch, unsigned int lo, unsigned int hi)
+  {
+    unsigned char oldSREG;
+
+    if ((ch > MAX_ANALOG_PIN) || (lo > hi))
+      {
+        return 0;
+      }
+
+    /* thresholds and starting level change together, as far as the ISR can tell */
+    oldSREG = SREG;
+    cli();
+    sched_analog_lo[ch] = lo;
+    sched_analog_hi[ch] = hi;
+    sched_analog_levels &= ~(1 << ch);
+    sched_analog_level0(ch, sched_analoglist[ch]);   /* from the last reading -- LOW if between */
+    SREG = oldSREG;
+
+    return 1;
+  }
+
+
+  char sched_ladder(unsigned char ch, const unsigned int *bounds, unsigned char n)
+  {
+    unsigned char oldSREG;
+    unsigned char b;
+    unsigned char c;
+
+    if ((ch > MAX_ANALOG_PIN) || (n > SCHED_LADDER_MAX))
+      {
+        return 0;
+      }
+
+    for (b=1; b<n; b++)
+      {
+        if (bounds[b] <= bounds[b-1])
+          {
+            return 0;
+          }
+      }
+
+    /* no ladder while the table is rebuilt */
+    oldSREG = SREG;
+    cli();
+    sched_ladder_ch = 0xFF;
+    SREG = oldSREG;
+
+    sched_ladder_n = n;
+
+    for (b=0; b<n; b++)
+      {
+        sched_ladder_bounds[b] = bounds[b];
+      }
+
+    /* lowest band whose bound lies above the bottom of each cell */
+    b = 0;
+
+    for (c=0; c<SCHED_LADDER_CELLS; c++)
+      {
+        while ((b < n) && (bounds[b] <= ((unsigned int)c << SCHED_LADDER_SHIFT)))
+          {
+            b++;
+          }
+
+        sched_ladder_lut[c] = b;
+      }
+
+    oldSREG = SREG;
+    cli();
+    if (ch < sched_num_analogs)
+      {
+        sched_ladder_level0(sched_analoglist[ch]);   /* from the last reading */
+      }
+    else
+      {
+        sched_ladder_levels = 0xFF;
+      }
+    sched_ladder_ch = (n ? ch : 0xFF);
+    SREG = oldSREG;
+
+    return 1;
+  }
+
+
+  char sched_pin_hwcount(char ident, char level, unsigned char holdoff)
+  {
+#ifdef SCHED_T1_PIN
+    unsigned char oldSREG;
+
+    if ((ident >= 0) && (ident != SCHED_T1_PIN))
+      {
+        return 0;
+      }
+
+    oldSREG = SREG;
+    cli();
+
+    TCCR1B = 0;       /* stop while changing over */
+    sched_t1_ident = ident;
+
+    if (ident >= 0)
+      {
+        TCCR1A = 0;   /* normal mode, no compare outputs, no interrupts */
+        TIMSK1 = 0;
+        TCNT1 = 0;
+        sched_t1_base = 0;
+        sched_t1_last = 0;
+        sched_t1_hold = 0;
+        sched_t1_holdoff = holdoff;
+        TCCR1B = (1<<CS12) | (1<<CS11) | (level ? (1<<CS10) : 0);   /* clocked by T1 -- rising or falling */
+      }
+
+    SREG = oldSREG;
+
+    return 1;
+#else
+    (void)ident;
+    (void)level;
+    (void)holdoff;
+
+    return 0;
+#endif
+  }
+
+
+  unsigned long sched_stamp(void)
+  {
+#if SCHED_BACKEND_COOP
+    return sched_stamp0();
+#else
+    unsigned long t;
+    unsigned char c;
+    unsigned char oldSREG;
+
+    oldSREG = SREG;
+    cli();
+    t = sched_ticks;
+    c = TCNT0;
+
+    /* past this period's COMPB point, but its interrupt is still waiting on ours -- count it now */
+#if(defined(__ATtinyX5__))
+    if ((TIFR & (1<<OCF0B)) && (c >= SCHED_PHASE1_OCR))
+#else
+    if ((TIFR0 & (1<<OCF0B)) && (c >= SCHED_PHASE1_OCR))
+#endif
+      {
+        t++;
+      }
+
+    SREG = oldSREG;
+
+    return (t << 8) | (unsigned char)(c - SCHED_PHASE1_OCR);
+#endif
+  }
+
+
+  char sched_check(char ident)   /* Manual asynchronous check of ID'd schedule --
+                                 return value HIGH means timeout was reached. */
+  {
+    char pos;
+    char ret = 0;
+
+    sched_api_busy++;      /* no swap until we are done with pos */
+    pos = sched_find0(ident);
+
+    if (pos >= 0)   /* else no existing event with this id was found */
+      {
+        ret = sched_check0(pos);
+      }
+
+    sched_api_busy--;
+
+    return ret;
+  }
+
+
+  static unsigned int sched_count0(sched *s, char level, char reset)   /* event count of one slot, optionally reset */
+  {
+    unsigned int val;
+    unsigned int holddown;
+    unsigned int holdup;
+#if SCHED_SHADOW_CHECK
+    unsigned char oldSREG;
+#endif
 
     /* Because counting is driven by an interrupt, it is possible for count to bump up during user retrieval
        or reset. The following are seemingly complicated, but avoid losing a count if that happens.
@@ -525,131 +2185,1139 @@ extern "C"    /* begin C-only code */
        only happen once if at all, since the interrupt in question only happens once per ms and this routine is
        MUCH faster than that. */
 
-    if (level)
+#ifdef SCHED_T1_PIN
+    if ((s->id == sched_t1_ident) && !sched_t1_holdoff)
+      {
+        return sched_t1_count0(reset);
+      }
+#endif
+
+    /* both are compared on reset below, so both need a starting value */
+    holdup = s->event_ct_up;
+    holddown = s->event_ct_down;
+
+    if (level)
+      {
+        /* get count of upward transitions -- make sure if interrupt happens, it is updated */
+        do
+          {
+            holdup = s->event_ct_up;
+            val = holdup;
+          }
+        while (holdup != s->event_ct_up);  /* falls through when count is stable */
+      }
+    else
+      {
+        /* get count of downward transitions -- make sure if interrupt happens, it is updated */
+        do
+          {
+            holddown = s->event_ct_down;
+            val = holddown;
+          }
+        while (holddown != s->event_ct_down);  /* falls through when count is stable */
+      }
+
+    if (reset)
+      {
+#if SCHED_SHADOW_CHECK
+        /* engine and reference must be reset as one, or the ISR could compare them half way through */
+        oldSREG = SREG;
+        cli();
+#endif
+
+        if (s->event_ct_up != holdup) /* Uh-oh, another interrupt just caught a count... */
+          {
+            /* We already have a count we can use, so pass the extra count to the next lookup */
+            s->event_ct_up = 1;
+          }
+        else
+          {
+            s->event_ct_up = 0;
+          }
+
+        if (s->event_ct_down != holddown) /* Uh-oh, another interrupt just caught a count... */
+          {
+            /* We already have a count we can use, so pass the extra count to the next lookup */
+            s->event_ct_down = 1;
+          }
+        else
+          {
+            s->event_ct_down = 0;
+          }
+
+#if SCHED_SHADOW_CHECK
+        s->ref.event_ct_up = s->event_ct_up;
+        s->ref.event_ct_down = s->event_ct_down;
+        SREG = oldSREG;
+#endif
+      }
+
+    return val;
+  }
+
+
+  unsigned int sched_pin_event_count(char ident, char level, char reset)
+  /* Manual asynchronous check of ID'd schedule --
+  return value is count of defined transition events since last reset. */
+  {
+    char pos;
+    unsigned int ret = 0;
+
+    sched_api_busy++;      /* no swap until we are done with pos */
+    pos = sched_find0(ident);
+
+    if (pos >= 0)   /* else no existing event with this id was found */
+      {
+        ret = sched_count0(&schedlist[pos], level, reset);
+      }
+
+    sched_api_busy--;
+
+    return ret;
+  }
+
+
+  char sched_pin_gohigh(char ident)   /* Manual asynchronous check of ID'd (debounced) pin change LOW to HIGH
+                                      returns HIGH on leading edge of change LOW to HIGH on associated pin. */
+  {
+    char pos;
+    char ret = 0;
+
+    sched_api_busy++;      /* no swap until we are done with pos */
+    pos = sched_find0(ident);
+
+    if (pos >= 0)   /* else no existing event with this id was found */
+      {
+        ret = sched_pin_test0(pos,1,1);
+      }
+
+    sched_api_busy--;
+
+    return ret;
+  }
+
+
+  /* The pin pools (idle, lifetime, bounce, measure) all start their entries with the char ident, -1
+     when free.  Position of ident's entry in one if it has one, else of a free one -- -1 if full. */
+
+  static char sched_pool_find0(void *pool, unsigned int size, unsigned char n, char ident)
+  {
+    unsigned char i;
+    char pos = -1;
+    char id;
+
+    for (i=0; i<n; i++)
+      {
+        id = *((char *)pool + i * size);
+
+        if ((id == ident) || ((pos < 0) && (id < 0)))
+          {
+            pos = i;
+          }
+      }
+
+    return pos;
+  }
+
+
+  char sched_pin_idle(char ident, unsigned int idle_ms, unsigned char slow_ms)
+  {
+    char pos;
+    unsigned char oldSREG;
+    sched_idle *c;
+
+    if ((ident < 0) || (ident > MAX_DIGITAL_PIN))
+      {
+        return 0;
+      }
+
+    pos = sched_pool_find0(sched_idlelist, sizeof(sched_idlelist[0]), SCHED_IDLE_MAX, ident);
+
+    if (pos < 0)
+      {
+        return !idle_ms;     /* nothing to stop */
+      }
+
+    c = &sched_idlelist[pos];
+
+    oldSREG = SREG;
+    cli();
+
+    if (idle_ms)
+      {
+        if (c->ident < 0)
+          {
+            sched_idle_used++;
+          }
+
+        c->ident = ident;
+        c->reg = portInputRegister(digitalPinToPort(ident));
+        c->mask = digitalPinToBitMask(ident);
+        c->idle_after = idle_ms;
+        c->quiet = 0;
+        c->slow = (slow_ms ? slow_ms : 1);
+        c->slow_left = c->slow;
+      }
+    else if (c->ident >= 0)
+      {
+        c->ident = -1;
+        sched_idle_used--;
+      }
+
+    SREG = oldSREG;
+
+    return 1;
+  }
+
+
+  char sched_pin_lifetime(char ident, char on)
+  {
+    char pos;
+    unsigned char oldSREG;
+    sched_life *c;
+
+    if (!SCHED_IS_PIN(ident))
+      {
+        return 0;
+      }
+
+    pos = sched_pool_find0(sched_lifelist, sizeof(sched_lifelist[0]), SCHED_LIFETIME_MAX, ident);
+
+    if (pos < 0)
+      {
+        return !on;     /* nothing to stop */
+      }
+
+    c = &sched_lifelist[pos];
+
+    oldSREG = SREG;
+    cli();
+
+    if (on)
+      {
+        if (c->ident < 0)
+          {
+            sched_life_used++;
+          }
+
+        c->ident = ident;
+        c->lo_up = 0;
+        c->lo_down = 0;
+        c->carry_up = 0;
+        c->carry_down = 0;
+        c->hi_up = 0;
+        c->hi_down = 0;
+
+#ifdef SCHED_T1_PIN
+        if ((ident == sched_t1_ident) && !sched_t1_holdoff)
+          {
+            /* the ISR only keeps this up while some pin is metered -- start from now, not from
+               whenever it was last moved, or the first tick adds every edge since */
+            sched_t1_last = TCNT1;
+          }
+#endif
+      }
+    else if (c->ident >= 0)
+      {
+        c->ident = -1;
+        sched_life_used--;
+      }
+
+    SREG = oldSREG;
+
+    return 1;
+  }
+
+
+  unsigned long sched_pin_lifetime_count(char ident, char level)
+  {
+    unsigned char i;
+    unsigned char oldSREG;
+    unsigned long count;
+    sched_life *c;
+
+    for (i=0; i<SCHED_LIFETIME_MAX; i++)
+      {
+        c = &sched_lifelist[i];
+
+        if (c->ident == ident)
+          {
+            oldSREG = SREG;
+            cli();          /* fold the carries in and take the low word together */
+
+            if (level)
+              {
+                c->hi_up += c->carry_up;
+                c->carry_up = 0;
+                count = ((unsigned long)c->hi_up << 16) | c->lo_up;
+              }
+            else
+              {
+                c->hi_down += c->carry_down;
+                c->carry_down = 0;
+                count = ((unsigned long)c->hi_down << 16) | c->lo_down;
+              }
+
+            SREG = oldSREG;
+
+            return count;
+          }
+      }
+
+    return 0;
+  }
+
+
+  char sched_bounce_watch(char ident, char on)
+  {
+    char pos;
+    unsigned char oldSREG;
+    sched_bnc *w;
+
+    if (!SCHED_IS_PIN(ident))
+      {
+        return 0;
+      }
+
+    pos = sched_pool_find0(sched_bnclist, sizeof(sched_bnclist[0]), SCHED_BOUNCE_MAX, ident);
+
+    if (pos < 0)
+      {
+        return !on;     /* nothing to stop */
+      }
+
+    w = &sched_bnclist[pos];
+
+    oldSREG = SREG;
+    cli();
+
+    if (on)
+      {
+        if (w->ident < 0)
+          {
+            sched_bnc_used++;
+          }
+
+        w->ident = ident;
+        w->flips = 0;
+        memset(&w->st, 0, sizeof(w->st));
+      }
+    else if (w->ident >= 0)
+      {
+        w->ident = -1;
+        sched_bnc_used--;
+      }
+
+    SREG = oldSREG;
+
+    return 1;
+  }
+
+
+  char sched_bounce_read(char ident, sched_bounce *out, char reset)
+  {
+    unsigned char i;
+    unsigned char oldSREG;
+
+    for (i=0; i<SCHED_BOUNCE_MAX; i++)
+      {
+        if (sched_bnclist[i].ident == ident)
+          {
+            oldSREG = SREG;
+            cli();
+            *out = sched_bnclist[i].st;
+
+            if (reset)
+              {
+                memset(&sched_bnclist[i].st, 0, sizeof(sched_bnclist[i].st));
+              }
+
+            SREG = oldSREG;
+
+            return 1;
+          }
+      }
+
+    return 0;
+  }
+
+
+  char sched_measure_start(char ident, unsigned int gate_ms, char raw)
+  {
+    char pos;
+    unsigned char oldSREG;
+    sched_meas *m;
+
+    if (!SCHED_IS_PIN(ident))
+      {
+        return 0;
+      }
+
+    pos = sched_pool_find0(sched_measlist, sizeof(sched_measlist[0]), SCHED_MEASURE_MAX, ident);
+
+    if (pos < 0)
+      {
+        return !gate_ms;     /* nothing to stop */
+      }
+
+    m = &sched_measlist[pos];
+
+    oldSREG = SREG;
+    cli();
+
+    if (gate_ms)
+      {
+        if (m->ident < 0)
+          {
+            sched_meas_used++;
+          }
+
+        m->ident = ident;
+        m->raw = raw;
+        m->last = HIGH;           /* a pin which starts HIGH is not a rising edge */
+        m->gate_ms = gate_ms;
+        m->start_ms = millis();
+        m->edges = 0;
+        m->high = 0;
+        m->samples = 0;
+        m->pub_edges = 0;
+        m->pub_high = 0;
+        m->pub_samples = 0;
+        m->pub_span = 0;
+        m->pub_gates = 0;
+      }
+    else if (m->ident >= 0)
+      {
+        m->ident = -1;
+        sched_meas_used--;
+      }
+
+    SREG = oldSREG;
+
+    return 1;
+  }
+
+
+  char sched_measure_read(char ident, sched_measurement *out)
+  {
+    unsigned char i;
+    char pos = -1;
+    unsigned char oldSREG;
+    unsigned int edges;
+    unsigned int high;
+    unsigned int samples;
+    unsigned long span;
+
+    for (i=0; i<SCHED_MEASURE_MAX; i++)
+      {
+        if (sched_measlist[i].ident == ident)
+          {
+            pos = i;
+          }
+      }
+
+    if (pos < 0)
+      {
+        return 0;
+      }
+
+    /* one gate's worth, all together */
+    oldSREG = SREG;
+    cli();
+    edges = sched_measlist[pos].pub_edges;
+    high = sched_measlist[pos].pub_high;
+    samples = sched_measlist[pos].pub_samples;
+    span = sched_measlist[pos].pub_span;
+    out->gates = sched_measlist[pos].pub_gates;
+    SREG = oldSREG;
+
+    /* the arithmetic is done here, in loop() time, rather than in the ISR */
+    out->edges = edges;
+    out->period_us = 0;
+    out->freq_chz = 0;
+    out->duty = 0;
+
+    if (edges >= 2)
+      {
+        out->period_us = SCHED_STAMP_US(span) / (edges - 1);
+      }
+
+    if (out->period_us)
+      {
+        out->freq_chz = 100000000UL / out->period_us;
+      }
+
+    if (samples)
+      {
+        out->duty = ((unsigned long)high * 100) / samples;
+      }
+
+    return (out->gates != 0);
+  }
+
+
+  char sched_pin_count_at(char ident, char level, unsigned char n)
+  {
+    char pos;
+    unsigned char oldSREG;
+
+    if (!SCHED_IS_PIN(ident))
+      {
+        return 0;
+      }
+
+    oldSREG = SREG;
+    cli();          /* lookup and use in one go -- no swap in between */
+    pos = sched_find0(ident);
+
+    if (pos >= 0)
+      {
+        schedlist[pos].count_flags = (level ? SCHED_CNT_LEVEL : 0) | SCHED_CNT_ARMED;
+        schedlist[pos].count_n = n;
+      }
+
+    SREG = oldSREG;
+
+    return (pos >= 0);
+  }
+
+
+  char sched_pin_count_ready(char ident)
+  {
+    char pos;
+    char ready = 0;
+    unsigned char oldSREG;
+
+    oldSREG = SREG;
+    cli();          /* lookup and use in one go -- no swap in between */
+    pos = sched_find0(ident);
+
+    if ((pos >= 0) && ((schedlist[pos].count_flags & SCHED_CNT_STATE) == SCHED_CNT_READY))
+      {
+        schedlist[pos].count_flags += (SCHED_CNT_SEEN - SCHED_CNT_READY);
+        ready = 1;
+      }
+
+    SREG = oldSREG;
+
+    return ready;
+  }
+
+
+  char sched_pin_change(char ident)   /* Manual asynchronous check of ID'd (debounced) pin change either way */
+  {
+    char pos;
+    char ret = -1;
+
+    sched_api_busy++;      /* no swap until we are done with pos */
+    pos = sched_find0(ident);
+
+    if ((pos >= 0) && schedlist[pos].active && schedlist[pos].debounce_change)
+      {
+        ret = sched_change0(&schedlist[pos], 1, 0);    /* consumes the change, gives the level */
+      }
+
+    sched_api_busy--;
+
+    return ret;
+  }
+
+
+  char sched_pin_golow(char ident)   /* Manual asynchronous check of ID'd (debounced) pin change HIGH to LOW
+                                      returns HIGH on leading edge of change HIGH to LOW on associated pin. */
+  {
+    char pos;
+    char ret = 0;
+
+    sched_api_busy++;      /* no swap until we are done with pos */
+    pos = sched_find0(ident);
+
+    if (pos >= 0)   /* else no existing event with this id was found */
+      {
+        ret = sched_pin_test0(pos,0,1);
+      }
+
+    sched_api_busy--;
+
+    return ret;
+  }
+
+
+  char sched_pin_level(char ident, char level)   /* Manual asynchronous check of ID'd debounce pin level
+                                                returns HIGH or LOW for current (debounced) level seen. */
+  {
+    char pos;
+    char ret = 0;
+
+    sched_api_busy++;      /* no swap until we are done with pos */
+    pos = sched_find0(ident);
+
+    if (pos >= 0)   /* else no existing event with this id was found */
+      {
+        ret = sched_pin_test0(pos,level,0);
+      }
+
+    sched_api_busy--;
+
+    return ret;
+  }
+
+#if SCHED_EDGE_TIMES
+  char sched_pin_edge_times(char ident, unsigned long *rawedge, unsigned long *confirm)
+  /* times of the first raw sample, and of the confirmation, of the latest transition on ID'd pin */
+  {
+    char pos;
+    char level = -1;
+    unsigned char oldSREG;
+
+    /* both times come from one transition only if the ISR can't get in between -- nor swap lists
+       between the lookup and the reads */
+    oldSREG = SREG;
+    cli();
+    pos = sched_find0(ident);
+
+    if (pos >= 0)   /* else no existing event with this id was found */
+      {
+        *rawedge = schedlist[pos].rawedge_st;
+        *confirm = schedlist[pos].edge_st;
+        level = schedlist[pos].debounce_state;
+      }
+
+    SREG = oldSREG;
+
+    return level;
+  }
+#endif
+
+
+  char sched_set_debounce(char up, char down, char max)
+  {
+    unsigned char oldSREG;
+
+    if ((!up) && (!down) && (!max))
+      {
+        up = DEBOUNCE_THRESH_UP;
+        down = DEBOUNCE_THRESH_DOWN;
+        max = DEBOUNCE_THRESH_MAX;
+      }
+
+    if (!((DEBOUNCE_THRESH_BOTTOM < down) && (down < up) && (up < max) && (max <= 100)))
+      {
+        return 0;
+      }
+
+    /* the ISR must never see a mix of old and new thresholds */
+    oldSREG = SREG;
+    cli();
+    sched_db_up = up;
+    sched_db_down = down;
+    sched_db_max = max;
+    SREG = oldSREG;
+
+    return 1;
+  }
+
+
+  void sched_get_debounce(char *up, char *down, char *max)
+  {
+    *up = sched_db_up;
+    *down = sched_db_down;
+    *max = sched_db_max;
+  }
+
+
+  char sched_set_priority(char ident, unsigned char prio)
+  {
+    char i;
+    char found = 0;
+
+    if (prio > SCHED_PRIO_NORMAL)
+      {
+        return 0;
+      }
+
+    sched_api_busy++;      /* no swap until both lists are done */
+
+    for (i=0; i<sched_count; i++)
+      {
+        if (ident == schedlist[i].id)
+          {
+            schedlist[i].prio = prio;
+            found = 1;
+          }
+      }
+
+    if (found)
+      {
+        sched_bucket_build0();
+      }
+
+    if (!sched_stage_ready)
+      {
+        /* and in a list being staged, so it holds across the swap */
+        for (i=0; i<sched_stage_count; i++)
+          {
+            if (ident == schedstage[i].id)
+              {
+                schedstage[i].prio = prio;
+                found = 1;
+              }
+          }
+      }
+
+    sched_api_busy--;
+
+    return found;
+  }
+
+#if SCHED_TWO_PHASE
+  char sched_pin_two_phase(char ident, char on)
+  {
+    char i;
+    char found = 0;
+
+    if ((ident < 0) || (ident > MAX_DIGITAL_PIN))
+      {
+        return 0;
+      }
+
+#ifdef SCHED_T1_PIN
+    if (ident == sched_t1_ident)
+      {
+        return 0;
+      }
+#endif
+
+    sched_api_busy++;      /* no swap until both lists are done */
+
+    for (i=0; i<sched_count; i++)
+      {
+        if (ident == schedlist[i].id)
+          {
+            schedlist[i].phase2 = (on != 0);
+            found = 1;
+          }
+      }
+
+    if (!sched_stage_ready)
+      {
+        /* and in a list being staged, so it holds across the swap */
+        for (i=0; i<sched_stage_count; i++)
+          {
+            if (ident == schedstage[i].id)
+              {
+                schedstage[i].phase2 = (on != 0);
+                found = 1;
+              }
+          }
+      }
+
+    sched_api_busy--;
+
+    return found;
+  }
+#endif
+
+
+  void sched_set_budget(unsigned char counts)
+  {
+    sched_budget = counts;     /* one byte -- the ISR sees all or nothing of it */
+  }
+
+
+  void sched_get_stats(sched_stats *st)   /* consistent copy of the scheduler statistics */
+  {
+    unsigned char oldSREG;
+
+    oldSREG = SREG;
+    cli();
+    *st = sched_stat;
+    SREG = oldSREG;
+  }
+
+
+  void sched_clear_stats(void)
+  {
+    unsigned char oldSREG;
+
+    oldSREG = SREG;
+    cli();
+    sched_stat.ticks = 0;
+    sched_stat.isr_total = 0;
+    sched_stat.isr_last = 0;
+    sched_stat.isr_max = 0;
+    sched_stat.deferred = 0;
+    sched_stat.work_last = 0;
+    sched_stat.work_max = 0;
+    sched_stat.peeks = 0;
+    sched_stat.lag_last = 0;
+    sched_stat.lag_max = 0;
+    sched_stat.skipped = 0;
+    SREG = oldSREG;
+  }
+
+
+#if SCHED_SHADOW_CHECK
+  char sched_shadow_status(sched_divergence *div)   /* returns HIGH if the live engine has disagreed with the
+                                                      reference since the last clear */
+  {
+    if (!sched_shadow_latched)
+      {
+        return 0;
+      }
+
+    if (div)
+      {
+        *div = sched_shadow_first;
+      }
+
+    return 1;
+  }
+
+
+  void sched_shadow_clear(void)
+  {
+    char i;
+    unsigned char oldSREG;
+
+    /* restart both sides from the engine's present state, or the old divergence would just latch again */
+    oldSREG = SREG;
+    cli();
+
+    for (i=0; i<sched_count; i++)
+      {
+        sched_shadow_sync0(&schedlist[i]);
+      }
+
+    sched_shadow_latched = 0;
+    SREG = oldSREG;
+  }
+
+
+  /* Bench equivalence run -- the live engine and the reference are fed the same pseudo-random stream on a
+     scratch slot which the ISR never sees.  The stream is mostly pin samples that hold their level with
+     occasional flips (so both clean edges and bursts of bounce occur), about 1 in 32 samples undebounced
+     as for a 0 ms recurring pin, and interleaved user calls: count reads with reset, and change checks.
+     A count reset must leave the counts at 0 here, since no interrupt can race it. */
+
+  unsigned long sched_shadow_selftest(unsigned long seed, unsigned long steps)
+  {
+    sched s;
+    unsigned long n;
+    unsigned long x;
+    unsigned char level = LOW;
+    unsigned char op;
+
+    x = seed;
+
+    if (x == 0)
       {
-        /* get count of upward transitions -- make sure if interrupt happens, it is updated */
-        do
-          {
-            holdup = schedlist[pos].event_ct_up;
-            val = holdup;
-          }
-        while (holdup != schedlist[pos].event_ct_up);  /* falls through when count is stable */
+        x = 1;    /* xorshift never leaves 0 */
       }
-    else
+
+    s.id = 0xFF;
+    s.laststate = LOW;
+    s.debounce_ct = DEBOUNCE_THRESH_BOTTOM;
+    s.debounce_state = LOW;
+    s.debounce_change = 0;
+    s.event_ct_up = 0;
+    s.event_ct_down = 0;
+    s.active = 1;
+    s.recurring = 1;
+    s.schedtime = 0;
+    s.schedms = 1;
+    sched_shadow_sync0(&s);
+
+    for (n=1; n<=steps; n++)
       {
-        /* get count of downward transitions -- make sure if interrupt happens, it is updated */
-        do
+        /* xorshift32 -- cheap and plenty random enough to shake out ordering differences */
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+
+        op = x & 0x1F;
+
+        if (op == 0)
           {
-            holddown = schedlist[pos].event_ct_down;
-            val = holddown;
+            /* user reads a count and resets it */
+            sched_count0(&s, (x >> 8) & 0x01, 1);
+            s.ref.event_ct_up = 0;
+            s.ref.event_ct_down = 0;
           }
-        while (holddown != schedlist[pos].event_ct_down);  /* falls through when count is stable */
-      }
-
-    if (reset)
-      {
-        if (schedlist[pos].event_ct_up != holdup) /* Uh-oh, another interrupt just caught a count... */
+        else if (op == 1)
           {
-            /* We already have a count we can use, so pass the extra count to the next lookup */
-            schedlist[pos].event_ct_up = 1;
+            /* user checks for an edge (or, with delta 0, the level) */
+            sched_change0(&s, (x >> 8) & 0x01, (x >> 9) & 0x01);
           }
         else
           {
-            schedlist[pos].event_ct_up = 0;
-          }
+            if (((x >> 8) & 0x07) == 0)
+              {
+                level = !level;
+              }
 
-        if (schedlist[pos].event_ct_down != holddown) /* Uh-oh, another interrupt just caught a count... */
-          {
-            /* We already have a count we can use, so pass the extra count to the next lookup */
-            schedlist[pos].event_ct_down = 1;
+            s.laststate = level;
+            sched_debounce0(&s, level, (op != 2));
+            sched_ref_debounce0(&(s.ref), level, (op != 2));
           }
-        else
+
+        if (sched_shadow_compare0(&s, n))
           {
-            schedlist[pos].event_ct_down = 0;
+            return n;
           }
       }
 
-    return val;
+    return 0;
   }
+#endif
 
 
-  char sched_pin_gohigh(char ident)   /* Manual asynchronous check of ID'd (debounced) pin change LOW to HIGH
-                                      returns HIGH on leading edge of change LOW to HIGH on associated pin. */
+#if SCHED_TRACE
+  void sched_trace_mark(unsigned char code)   /* add a user marker record to the trace */
   {
-    char i;
-    char pos = -1;
+    sched_trace_put0(SCHED_TRC_MARK, code, millis());
+  }
 
-    /* see if this event id is already in list */
-    for (i=0; i<sched_count; i++)
+
+  unsigned char sched_trace_read(unsigned char *buf, unsigned char max, unsigned long *base, unsigned char *dropped)
+  {
+    unsigned char n = 0;
+    unsigned char len;
+    unsigned char i;
+    unsigned long dt;
+    unsigned char oldSREG;
+
+    oldSREG = SREG;
+    cli();
+
+    *base = sched_trace_basems;
+    *dropped = sched_trace_dropped;
+    sched_trace_dropped = 0;
+
+    while (sched_trace_used)
       {
-        if (ident == schedlist[i].id)
+        len = sched_trace_reclen0(sched_trace_tail, &dt);
+
+        if ((n + len) > max)
           {
-            pos = i;
+            break;      /* whole records only -- the rest waits for the next read */
           }
-      }
 
-    if (pos < 0)   /* NOT already in list */
-      {
-        /* No existing event with this id was found. */
-        return 0;
+        for (i=0; i<len; i++)
+          {
+            buf[n++] = sched_trace_buf[sched_trace_tail];
+            sched_trace_tail = (sched_trace_tail + 1) & SCHED_TRACE_MASK;
+          }
+
+        sched_trace_used -= len;
+        sched_trace_basems += dt;
       }
 
-    return sched_pin_test0(pos,1,1);
+    SREG = oldSREG;
+
+    return n;
   }
 
 
-  char sched_pin_golow(char ident)   /* Manual asynchronous check of ID'd (debounced) pin change HIGH to LOW
-                                      returns HIGH on leading edge of change HIGH to LOW on associated pin. */
+  void sched_trace_dump(void (*putbyte)(unsigned char))
   {
-    char i;
-    char pos = -1;
-
-    /* see if this event id is already in list */
-    for (i=0; i<sched_count; i++)
+    unsigned char chunk[32];
+    unsigned char n;
+    unsigned char i;
+    unsigned char dropped;
+    unsigned char sum;
+    unsigned long base;
+    unsigned int sent = 0;
+
+    /* Interrupts are only held off while a chunk is copied out, not while it is sent.  Always send at least
+       one frame so the host sees an answer even with an empty trace, and give up after one ring's worth
+       so a busy pin can't keep us here forever. */
+    do
       {
-        if (ident == schedlist[i].id)
+        n = sched_trace_read(chunk, sizeof(chunk), &base, &dropped);
+
+        putbyte(0x7E);
+        putbyte('T');
+
+        sum = n;
+        putbyte(n);
+
+        for (i=0; i<4; i++)
           {
-            pos = i;
+            sum += (unsigned char)base;
+            putbyte((unsigned char)base);
+            base >>= 8;
           }
-      }
 
-    if (pos < 0)   /* NOT already in list */
-      {
-        /* No existing event with this id was found. */
-        return 0;
+        sum += dropped;
+        putbyte(dropped);
+
+        for (i=0; i<n; i++)
+          {
+            sum += chunk[i];
+            putbyte(chunk[i]);
+          }
+
+        putbyte(sum);
+
+        sent += n;
       }
+    while (n && (sent < SCHED_TRACE_SIZE));
+  }
+
+
+  void sched_trace_clear(void)
+  {
+    unsigned char oldSREG;
+
+    oldSREG = SREG;
+    cli();
 
-    return sched_pin_test0(pos,0,1);
+    sched_trace_head = 0;
+    sched_trace_tail = 0;
+    sched_trace_used = 0;
+    sched_trace_dropped = 0;
+    sched_trace_isrmax = 0;
+    sched_trace_lastms = millis();
+    sched_trace_basems = sched_trace_lastms;
+
+    SREG = oldSREG;
   }
+#endif
 
 
-  char sched_pin_level(char ident, char level)   /* Manual asynchronous check of ID'd debounce pin level
-                                                returns HIGH or LOW for current (debounced) level seen. */
+  static volatile unsigned int alog_val = 1023;
+  static volatile uint8_t ahigh = 0x03;
+  static volatile uint8_t alow = 0xFF;
+
+
+  /* One step of the background analog scan, called from the ISR while any analog ports are to be
+     scanned. */
+
+  /* To ensure timing of input/output is crisply synchronized with the timer, don't use the
+  AnalogRead() function directly, since it holds until conversion complete, a delay of
+  indeterminate time.  Instead, decompose the AnalogRead function here, starting an input
+  ADC conversion, then outputting to DAC whil ADC is in progress, then finally completing
+  the ADC conversion and acquiring the input data.
+
+  NOTE:  At this time this code is only KNOWN to work on the ATMEGA328 (Duemilonovae
+         or Diavolino).
+  */
+
+  static void sched_analog_step0(void)
   {
-    char i;
-    char pos = -1;
+    unsigned char ch;
 
-    /* see if this event id is already in list */
-    for (i=0; i<sched_count; i++)
+    /* Built-in analogRead function blocks because it must start an ADC conversion,
+       then wait for results.  To avoid the wait, work backwards -- read the result FIRST,
+       assuming it was ALREADY set up for conversion at least 1 ms earlier.
+    */
+
+    /* Assume conversion is complete, read the result for current analog port, then store it
+       in the corresponding position in array. */
+
+    /* finish any ADC conversion started in previous loop -- this takes up to 25
+       ADC clock cycles and so completes between 1 ms clock ticks (timer 0 calls)
+       which set up millis() used to schedule the start of these analog reads. */
+
+#if defined(ADCSRA) && defined(ADCL) && SCHED_ADC_AUTO
+    /* Conversions start in hardware at each Timer0 overflow.  ADSC reads one while the conversion
+       started at this tick's overflow is still going, and the data registers then hold the one
+       before.  If it finishes while we read, we can't tell which we got -- drop the sample. */
+    ch = (ADCSRA & (1<<ADSC)) ? sched_adc_prev : sched_adc_busy;
+    alow  = ADCL;
+    ahigh = ADCH;
+
+    if ((ch == sched_adc_prev) && !(ADCSRA & (1<<ADSC)))
       {
-        if (ident == schedlist[i].id)
+        ch = 0xFF;
+      }
+#elif defined(ADCSRA) && defined(ADCL)
+    /* ADSC is cleared when the conversion finishes -- for now just assume that */
+    ch = sched_current_analog;
+    alow  = ADCL;
+    ahigh = ADCH;
+#else
+    /* we dont have an ADC, return 0 */
+    ch = sched_current_analog;
+    alow  = 0;
+    ahigh = 0;
+#endif
+
+    /* combine the two bytes into one 10-bit value */
+    alog_val = (ahigh << 8) | alow;
+
+    if (ch < sched_num_analogs)    /* else left over from before a reconfiguration, or dropped */
+      {
+        sched_analoglist[ch] = alog_val;
+        sched_analog_level0(ch, alog_val);
+
+        if (ch == sched_ladder_ch)
           {
-            pos = i;
+            sched_ladder_level0(alog_val);
           }
       }
 
-    if (pos < 0)   /* NOT already in list */
+    sched_current_analog++;
+
+    if (sched_current_analog >= sched_num_analogs)
       {
-        /* No existing event with this id was found. */
-        return 0;
+        sched_current_analog = 0;
       }
 
-    return sched_pin_test0(pos,level,0);
-  }
+    /* Start a new conversion for the next port -- get the results next time through. */
+#if defined(ADMUX)
+    /* For some unknown reason, a statement of the form:
+                      ADMUX = (0x40) | (sched_current_analog & 0x07);
+       does not work -- a constant seems to be necessary instead of sched_current_analog.
+       Therefore, work around with switch statement.           */
 
-  static volatile unsigned int alog_val = 1023;
-  static volatile uint8_t ahigh = 0x03;
-  static volatile uint8_t alow = 0xFF;
+    /* Note: the (0x40) below sets up 10-bit ADC (from ATMEL manual) */
+    switch (sched_current_analog)
+      {
+        case 1:
+          {
+            ADMUX = (0x40) | (0x01);
+            break;
+          }
+
+        case 2:
+          {
+            ADMUX = (0x40) | (0x02);
+            break;
+          }
+
+        case 3:
+          {
+            ADMUX = (0x40) | (0x03);
+            break;
+          }
+
+        case 4:
+          {
+            ADMUX = (0x40) | (0x04);
+            break;
+          }
+
+        case 5:
+          {
+            ADMUX = (0x40) | (0x05);
+            break;
+          }
+
+        default:  /* assume port 0 */
+          {
+            ADMUX = (0x40) | (0x00);
+          }
+      }
+
+#endif
+#if SCHED_ADC_AUTO
+    sched_adc_mux = sched_current_analog;    /* ...taken up by the next overflow's conversion */
+#elif defined(ADCSRA) && defined(ADCL)
+    sbi(ADCSRA, ADSC);
+#endif
+  }
 
 
   /* ------------------------------------------------------------------------------------------------ */
@@ -666,9 +3334,12 @@ extern "C"    /* begin C-only code */
                         to prevent accidental user calls.
   */
 
-  static void sched_background_int(void)
+  static void sched_background_int(unsigned char isrstart)   /* isrstart -- TCNT0 at ISR entry, for the budget */
   {
     char i;
+    char n;
+    char normal;
+    unsigned char b;
     char toss;
     unsigned long timems;
 
@@ -688,117 +3359,183 @@ extern "C"    /* begin C-only code */
     /* at this point a 1 ms elapsed event has been triggered, and all processes
        which depend on that trigger should be executed */
     sched_priorms = timems;
+    sched_work = 0;
 
-    /* if any analog ports are to be scanned, do so now... */
-
-    /* To ensure timing of input/output is crisply synchronized with the timer, don't use the
-    AnalogRead() function directly, since it holds until conversion complete, a delay of
-    indeterminate time.  Instead, decompose the AnalogRead function here, starting an input
-    ADC conversion, then outputting to DAC whil ADC is in progress, then finally completing
-    the ADC conversion and acquiring the input data.
+#if SCHED_ADC_AUTO
+    /* the overflow just past started a conversion on whatever ADMUX selected -- whether or not
+       the last analog step ran */
+    sched_adc_prev = sched_adc_busy;
+    sched_adc_busy = sched_adc_mux;
+#endif
 
-    NOTE:  At this time this code is only KNOWN to work on the ATMEGA328 (Duemilonovae
-           or Diavolino).
-    */
+    /* a committed reconfiguration goes in between ticks, so every slot sees every tick -- and not
+       while loop() is part way through a call on the live list (it goes in a tick later) */
+    if (sched_stage_ready && !sched_api_busy)
+      {
+        sched_stage_swap0();
+      }
 
-    if (sched_num_analogs)
+    /* check for any digital pin debounce monitors -- critical ones always, every tick */
+    for (i=0; i<sched_bucket_crit; i++)
       {
-        /* Built-in analogRead function blocks because it must start an ADC conversion,
-           then wait for results.  To avoid the wait, work backwards -- read the result FIRST,
-           assuming it was ALREADY set up for conversion at least 1 ms earlier.
-        */
+        toss = sched_check0(sched_bucket[0][i]);
+      }
 
-        /* Assume conversion is complete, read the result for current analog port, then store it
-           in the corresponding position in array. */
+    /* ...then normal ones while the budget lasts, starting where the budget last ran out so that
+       no pin is always the one put off */
+    normal = sched_bucket_n[0] - sched_bucket_crit;
+    i = sched_defer_next;
 
-        /* finish any ADC conversion started in previous loop -- this takes up to 25
-           ADC clock cycles and so completes between 1 ms clock ticks (timer 0 calls)
-           which set up millis() used to schedule the start of these analog reads. */
+    for (n=0; n<normal; n++, i++)
+      {
+        if (i >= normal)
+          {
+            i = 0;
+          }
 
-#if defined(ADCSRA) && defined(ADCL)
-        /* ADSC is cleared when the conversion finishes -- for now just assume that */
-        alow  = ADCL;
-        ahigh = ADCH;
-#else
-        /* we dont have an ADC, return 0 */
-        alow  = 0;
-        ahigh = 0;
-#endif
+        if (sched_budget && ((unsigned char)(TCNT0 - isrstart) >= sched_budget))
+          {
+            sched_defer_next = i;
+            sched_stat.deferred++;
+            break;
+          }
 
-        /* combine the two bytes into one 10-bit value */
-        alog_val = (ahigh << 8) | alow;
+        toss = sched_check0(sched_bucket[0][sched_bucket_crit + i]);
+      }
 
-        sched_analoglist[sched_current_analog] = alog_val;
-        sched_current_analog++;
+    if (n >= normal)
+      {
+        sched_defer_next = 0;
+      }
 
-        if (sched_current_analog >= sched_num_analogs)
+    /* ...then the slow pins, on their bucket's tick only -- a bucket cut short by the budget is
+       visited again next tick, where those already done are no longer due */
+    for (b=1; b<SCHED_BUCKETS; b++)
+      {
+        if (--sched_bucket_left[b])
           {
-            sched_current_analog = 0;
+            continue;
           }
 
-        /* Start a new conversion for the next port -- get the results next time through. */
-#if defined(ADMUX)
-        /* For some unknown reason, a statement of the form:
-                          ADMUX = (0x40) | (sched_current_analog & 0x07);
-           does not work -- a constant seems to be necessary instead of sched_current_analog.
-           Therefore, work around with switch statement.           */
+        sched_bucket_left[b] = sched_bucket_ms[b];
 
-        /* Note: the (0x40) below sets up 10-bit ADC (from ATMEL manual) */
-        switch (sched_current_analog)
+        for (n=0; n<sched_bucket_n[b]; n++)
           {
-            case 1:
+            if (sched_budget && ((unsigned char)(TCNT0 - isrstart) >= sched_budget))
               {
-                ADMUX = (0x40) | (0x01);
+                sched_stat.deferred++;
+                sched_bucket_left[b] = 1;
                 break;
               }
 
-            case 2:
-              {
-                ADMUX = (0x40) | (0x02);
-                break;
-              }
+            toss = sched_check0(sched_bucket[b][n]);
+          }
+      }
 
-            case 3:
-              {
-                ADMUX = (0x40) | (0x03);
-                break;
-              }
+    /* ...and analog scanning last -- a skipped step just leaves the conversion in hand for the next tick */
+    if (sched_num_analogs)
+      {
+        if (sched_budget && ((unsigned char)(TCNT0 - isrstart) >= sched_budget))
+          {
+            sched_stat.deferred++;
+          }
+        else
+          {
+            sched_analog_step0();
+          }
+      }
 
-            case 4:
-              {
-                ADMUX = (0x40) | (0x04);
-                break;
-              }
+    sched_stat.work_last = sched_work;
 
-            case 5:
-              {
-                ADMUX = (0x40) | (0x05);
-                break;
-              }
+    if (sched_work > sched_stat.work_max)
+      {
+        sched_stat.work_max = sched_work;
+      }
+  }
 
-            default:  /* assume port 0 */
-              {
-                ADMUX = (0x40) | (0x00);
-              }
-          }
 
-#endif
-#if defined(ADCSRA) && defined(ADCL)
-        sbi(ADCSRA, ADSC);
-#endif
+
+
+  /* One tick of schedule maintenance, and its statistics -- isrtime is TCNT0 as the tick began */
+
+  static void sched_pass0(unsigned char isrtime)
+  {
+    sched_background_int(isrtime);
+
+    isrtime = TCNT0 - isrtime;    /* 8-bit wrap does the right thing */
+
+    sched_stat.ticks++;
+    sched_stat.isr_total += isrtime;
+    sched_stat.isr_last = isrtime;
+
+    if (isrtime > sched_stat.isr_max)
+      {
+        sched_stat.isr_max = isrtime;
       }
 
-    /* check for any digital pin debounce monitors... */
-    for (i=0; i<sched_count; i++)
+#if SCHED_TRACE
+    if (isrtime > sched_trace_isrmax)
       {
-        if ((schedlist[i].id >= 0) && (schedlist[i].id <= MAX_DIGITAL_PIN)) /* if this is a monitored pin... */
-          {
-            toss = sched_check0(i);
-          }
+        sched_trace_isrmax = isrtime;
+        sched_trace_put0(SCHED_TRC_ISR, isrtime, sched_priorms);
       }
+#endif
   }
 
 
+#if SCHED_BACKEND_COOP
+  /* Cooperative backend -- the ticks the ISR would have run, run from the user event loop.  Each
+     millisecond since the last call is one tick, so a loop() held up for a few ms catches up with
+     that many passes back to back (pins sampled then all see the level of the moment); past
+     SCHED_COOP_CATCHUP of them the rest are given up and counted as skipped. */
+
+  void sched_service(void)
+  {
+    unsigned long timems;
+    unsigned long owed;
+
+    if (!sched_initialized)
+      {
+        return;
+      }
+
+    timems = millis();
+
+    if (timems == sched_service_ms)     /* the usual case -- nothing owed yet */
+      {
+        return;
+      }
+
+    owed = timems - sched_service_ms;
+    sched_service_ms = timems;
+
+    sched_stamp0();    /* keeps the stamp's micros() difference well short of wrapping */
+
+    sched_stat.lag_last = ((owed > 0xFF) ? 0xFF : owed);
+
+    if (sched_stat.lag_last > sched_stat.lag_max)
+      {
+        sched_stat.lag_max = sched_stat.lag_last;
+      }
+
+    if (owed > SCHED_COOP_CATCHUP)
+      {
+        sched_stat.skipped += owed - SCHED_COOP_CATCHUP;
+        owed = SCHED_COOP_CATCHUP;
+      }
+
+    while (owed--)
+      {
+        sched_ticks++;
+        sched_pass0(TCNT0);
+      }
+  }
+
+#else
+  void sched_service(void)
+  {
+    /* nothing to do -- the COMPB interrupt runs the ticks */
+  }
 
 
   /*
@@ -841,6 +3578,12 @@ extern "C"    /* begin C-only code */
   ISR(TIMER0_COMPB_vect)
 #endif
   {
+    unsigned char isrtime = TCNT0;    /* Timer0 count at entry -- for ISR duration statistics */
+
+    sched_ticks++;   /* before sei() -- the stamp read in loop() must never see a stale count */
+#if SCHED_TWO_PHASE
+    sched_isr_busy = 1;
+#endif
     sei();   /* NOTE: leave interrupts enabled as early as possible */
 
     /* It is assumed that this ISR is called once per ms, and will take much less than 1 ms to complete. */
@@ -858,7 +3601,7 @@ extern "C"    /* begin C-only code */
         /* Call schedule maintenance here -- in the "sched_coop" version of the scheduler, this
            was a required call in the user event loop. */
 
-        sched_background_int();
+        sched_pass0(isrtime);
       }
 
     /* Do not need to reload the timer count value -- it is auto-incremented and
@@ -870,7 +3613,66 @@ extern "C"    /* begin C-only code */
       Though this timing is not really that tight, it does appear that lower values
       of OCR0B (COMPB count spec) cause the COMPB vector to execute closer to the
       end of the OVF vector which updates the millis() count. */
+
+#if SCHED_TWO_PHASE
+    sched_isr_busy = 0;
+#endif
+  }
+#endif   /* ... of SCHED_BACKEND_COOP */
+
+
+#if SCHED_TWO_PHASE
+  /* Second sampling phase, half a Timer0 period after the first -- samples every pin which is
+     sampled every tick once more, so pins are seen twice per ms.  Timers and the analog scan are
+     left to the COMPB pass.
+
+     Interrupts stay disabled here: the pass is short, and COMPB (and the millis() overflow) must not
+     break into it.  If COMPB is still at work when this fires, this pass is skipped instead. */
+
+#if(defined(__ATtinyX5__))
+  ISR(TIM0_COMPA_vect)
+#else
+  ISR(TIMER0_COMPA_vect)
+#endif
+  {
+    unsigned char isrstart = TCNT0;
+    unsigned long timems;
+    char i;
+    char n;
+
+    if (!sched_initialized || sched_isr_busy)
+      {
+        return;
+      }
+
+    timems = millis();
+
+    for (n=0; n<sched_bucket_n[0]; n++)     /* every-tick pins are all in bucket 0, critical first */
+      {
+        i = sched_bucket[0][n];
+
+        /* only pins put on this pass -- the rest, and anything counting in samples per ms on them,
+           would otherwise run at double rate unasked */
+        if (schedlist[i].phase2 && schedlist[i].active && schedlist[i].recurring && (schedlist[i].schedms <= 1))
+          {
+#ifdef SCHED_T1_PIN
+            if ((char)schedlist[i].id == sched_t1_ident)
+              {
+                continue;       /* counted by Timer1 -- the holdoff counts ticks */
+              }
+#endif
+            if ((n >= sched_bucket_crit)
+                && sched_budget && ((unsigned char)(TCNT0 - isrstart) >= sched_budget))
+              {
+                sched_stat.deferred++;
+                continue;
+              }
+
+            sched_pin_step0(i, (schedlist[i].schedms != 0), timems);
+          }
+      }
   }
+#endif
 
 
 
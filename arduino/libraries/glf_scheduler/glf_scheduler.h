@@ -56,10 +56,259 @@
    If debounced pins are scheduled, usually a 1 ms recurring period is specified for that pin.
    However, if a 0 ms recurring period is specified, debouncing will be turned OFF and state of
    the pin will be polled every 1 ms, and changes noted as if debounced, but without delay.
+
+   Idents SCHED_ANALOG_PIN(0) up to SCHED_ANALOG_PIN(MAX_ANALOG_PIN) are analog virtual pins: a
+   scanned analog channel turned into a level by a Schmitt trigger -- HIGH above the channel's high
+   threshold, LOW below its low threshold, unchanged between (see sched_analog_pin()) -- and then
+   scheduled and debounced exactly like a digital pin, with the same gohigh/golow, level and event
+   count calls.  The channel must be within the scan set given to sched_list_init().  The level
+   follows each new reading of the channel, so with n channels scanned it can change every n ms.
    */
 
+#define SCHED_ANALOG_BASE    100
+#define SCHED_ANALOG_PIN(ch) (SCHED_ANALOG_BASE + (ch))
+
+/* Idents SCHED_LADDER_PIN(0) up to SCHED_LADDER_PIN(SCHED_LADDER_MAX-1) are the buttons of a resistor
+   ladder -- several buttons on one analog channel, each pulling it to a different voltage.  Each
+   reading of the channel is classified into a band (see sched_ladder()), and the button of that
+   band reads LOW, the others HIGH -- like buttons on INPUT_PULLUP pins.  They are then scheduled and
+   debounced exactly like digital pins.  Only one button of a ladder can be seen pressed at a time. */
+
+/* The Timer1 external clock input T1, on which sched_pin_hwcount() can count pulses in hardware --
+   not on the ATtiny85, whose Timer1 has no external clock, nor the Teensy, whose T1 is the LED */
+#if !defined(__ATtinyX5__) && !defined(CORE_TEENSY)
+#define SCHED_T1_PIN  5
+#endif
+
+#define SCHED_LADDER_BASE    110
+#define SCHED_LADDER_MAX     8
+#define SCHED_LADDER_PIN(b)  (SCHED_LADDER_BASE + (b))
+
+#define SCHED_IS_PIN(id) ((((id) >= 0) && ((id) <= MAX_DIGITAL_PIN)) \
+                          || (((id) >= SCHED_ANALOG_BASE) && ((id) <= (SCHED_ANALOG_BASE + MAX_ANALOG_PIN))) \
+                          || (((id) >= SCHED_LADDER_BASE) && ((id) < (SCHED_LADDER_BASE + SCHED_LADDER_MAX))))
+
+#define SCHED_ANALOG_LO  410      /* default thresholds -- 2.0 V and 3.0 V with a 5 V reference */
+#define SCHED_ANALOG_HI  614
+
 #define MAX_SCHED 10
 
+/* Optional differential check of the debounce engine.  When SCHED_SHADOW_CHECK is nonzero, every
+   schedule slot carries a second copy of its debounce state, advanced by a copy of the 2015/05/18
+   integrator on exactly the samples the live engine sees.  The copy reads the same run-time
+   thresholds as the engine (see sched_set_debounce()), so it checks the integrator only -- timers,
+   the ISR and the API are covered by the host comparison against the whole 2015/05/18 library in
+   extras/host.  The first disagreement between the two is latched for sched_shadow_status().
+   sched_shadow_selftest() drives both on a scratch slot with a pseudo-random pin and API-call
+   stream, so a rewritten engine can be checked on the bench before it is trusted in the field.
+   Costs 7 bytes of RAM per slot and roughly doubles the per-pin ISR work -- leave it off in
+   production builds. */
+#ifndef SCHED_SHADOW_CHECK
+#define SCHED_SHADOW_CHECK 0
+#endif
+
+#if SCHED_SHADOW_CHECK
+/* Reference copy of the debounce state of one slot -- only touched by the reference integrator. */
+typedef struct
+{
+  volatile char debounce_ct;
+  volatile unsigned char debounce_state;
+  volatile unsigned char debounce_change;
+  volatile unsigned int event_ct_up;
+  volatile unsigned int event_ct_down;
+}
+sched_ref;
+
+/* First divergence seen between live engine and reference.  field is one of SCHED_DIV_xxx. */
+typedef struct
+{
+  unsigned long ms;          /* millis() of the sample (or step number in sched_shadow_selftest()) */
+  char ident;                /* schedule id of the slot */
+  unsigned char field;
+  unsigned int engine;       /* value held by the live engine */
+  unsigned int reference;    /* value held by the reference */
+}
+sched_divergence;
+
+#define SCHED_DIV_NONE    0
+#define SCHED_DIV_CT      1
+#define SCHED_DIV_STATE   2
+#define SCHED_DIV_CHANGE  3
+#define SCHED_DIV_UP      4
+#define SCHED_DIV_DOWN    5
+#endif
+
+/* Optional event trace -- a small flight recorder of what the scheduler saw, kept in a RAM ring and
+   overwritten oldest-first.  Records are written from the ISR (debounced pin edges, new worst-case ISR
+   durations) and from sched_check() (user timer expiries), at a few dozen cycles each.
+
+   Each record is:   header byte, time since the previous record in ms as a varint (7 bits per byte,
+                     least significant first, bit 7 set on all but the last byte), one payload byte.
+
+      header SCHED_TRC_EDGE|level   payload = ident of pin, level = new debounced level (0 or 1)
+      header SCHED_TRC_TIMER        payload = ident of user timer which timed out
+      header SCHED_TRC_ISR          payload = ISR duration in Timer0 counts (64 clocks -- 4 us at 16 Mhz)
+                                    written only when it exceeds the worst seen since sched_trace_clear()
+      header SCHED_TRC_MARK         payload = code given to sched_trace_mark() by the user program
+
+   sched_trace_dump() drains the ring as one or more frames:
+
+      0x7E 'T' n base(4 bytes, little-endian) dropped <n bytes of records> sum
+
+   where base is the millis() time the first record's delta counts from, dropped is the number of
+   records overwritten before they could be read (saturating at 255) and sum is the 8-bit sum of every
+   byte from n through the last record byte.  Consecutive frames continue the same time line.
+   extras/host/trace_decode turns a capture of the port into text, which extras/host/trace_run can
+   replay through the library.  SCHED_TRACE_SIZE must be a power of 2, and no larger than 128. */
+#ifndef SCHED_TRACE
+#if(defined(__ATtinyX5__))
+#define SCHED_TRACE 0
+#else
+#define SCHED_TRACE 1
+#endif
+#endif
+
+#ifndef SCHED_TRACE_SIZE
+#define SCHED_TRACE_SIZE 128
+#endif
+
+#define SCHED_TRC_EDGE   0x10
+#define SCHED_TRC_TIMER  0x20
+#define SCHED_TRC_ISR    0x30
+#define SCHED_TRC_MARK   0x40
+
+/* Optional edge timestamps for latency measurement.  With SCHED_EDGE_TIMES nonzero, each debounced
+   pin remembers when its most recent transition was confirmed by the integrator, and when the first
+   raw sample of that transition was seen -- so the time spent in debouncing can be told apart from
+   time spent elsewhere.  A raw change which dies out (the pin matching its debounced level again for
+   SCHED_RAW_QUIET samples running) is forgotten as a glitch.  Costs 9 bytes of RAM per slot. */
+#ifndef SCHED_EDGE_TIMES
+#if(defined(__ATtinyX5__))
+#define SCHED_EDGE_TIMES 0
+#else
+#define SCHED_EDGE_TIMES 1
+#endif
+#endif
+
+#define SCHED_RAW_QUIET 5
+
+/* Optional hardware-triggered analog scan.  Normally the ISR starts each conversion itself, so the
+   sampling instant wanders with interrupt latency.  With SCHED_ADC_AUTO nonzero the ADC is put in
+   auto-trigger mode on the Timer0 overflow, which starts every conversion at the same point of the
+   1 ms cycle, and the ISR only reads results and chooses the next channel.  Results then arrive one
+   tick later than before.  Do not call analogRead() in this mode -- it changes ADMUX under the
+   scan, so results would be filed against the wrong channel. */
+#ifndef SCHED_ADC_AUTO
+#define SCHED_ADC_AUTO 0
+#endif
+
+/* Optional second sampling phase.  With SCHED_TWO_PHASE nonzero the Timer0 COMPA interrupt is used
+   as well, at OCR0A = SCHED_PHASE2_OCR (half way round from COMPB), to sample a second time each
+   digital pin of 0 or 1 ms period that sched_pin_two_phase() has put on it -- halving the time to
+   see an edge.  Everything that counts samples of such a pin then runs twice as fast: the debounce
+   thresholds (double them with sched_set_debounce() to keep the old filter time -- they are shared
+   by all pins), the stable run sched_pin_idle() waits for, and a measurement gate's sample count.
+   Neither millis() nor another timer is touched, but OCR0A is the PWM compare for analogWrite() on
+   pin 6 (pin 0 on the ATtiny85), which must not then be used. */
+#ifndef SCHED_TWO_PHASE
+#define SCHED_TWO_PHASE 0
+#endif
+#define SCHED_PHASE1_OCR  4        /* OCR0B -- the COMPB pass, just after the millis() overflow */
+#define SCHED_PHASE2_OCR  (SCHED_PHASE1_OCR + 128)
+
+/* Backend.  By default the ticks are run by the Timer0 COMPB interrupt, which sched_list_init() sets
+   up by rewriting TCCR0A, TCCR0B and OCR0B -- taking Timer0's compare channels (and the PWM of their
+   pins) from the core and other libraries.  With SCHED_BACKEND_COOP nonzero Timer0 is not touched,
+   and the same ticks are run by sched_service(), to be called from the user event loop: each ms
+   since the last call is one tick, run back to back on catching up, up to SCHED_COOP_CATCHUP at a
+   time.  Pins are then seen as late as loop() is slow -- lag_max in sched_stats says by how much --
+   and isr_total becomes the loop time spent on ticks.  Stamps are counted up from micros() in the
+   same units, and run the full 32 bits as the ISR's do as long as sched_service() is called at least
+   once an hour.  SCHED_TWO_PHASE and SCHED_ADC_AUTO need the interrupt. */
+#ifndef SCHED_BACKEND_COOP
+#define SCHED_BACKEND_COOP 0
+#endif
+#ifndef SCHED_COOP_CATCHUP
+#define SCHED_COOP_CATCHUP 8
+#endif
+#if SCHED_BACKEND_COOP && (SCHED_TWO_PHASE || SCHED_ADC_AUTO)
+#error "SCHED_TWO_PHASE and SCHED_ADC_AUTO need the Timer0 interrupt -- not SCHED_BACKEND_COOP"
+#endif
+
+/* Phase staggering.  With SCHED_STAGGER nonzero, sched_event() and sched_stage_event() place a recurring
+   pin of 2 ms or more half way across the widest gap between the phases of the pins already there
+   with the same period, instead of one period from now -- so pins sampled every 5 ms, say, take turns
+   rather than all landing on one tick, and the busiest pass of the ISR is shorter for the same
+   average.  The first sample still comes within one period.  User timers are not moved: they expire
+   one period after sched_event() as they always have.  sched_event_phase() sets a phase outright,
+   for either. */
+#ifndef SCHED_STAGGER
+#define SCHED_STAGGER 1
+#endif
+#define SCHED_PHASE_AUTO  0xFFFFFFFFUL   /* phase for sched_event_phase() -- stagger as sched_event() */
+
+/* Sub-tick stamps -- the count of 1 ms scheduler passes in the upper 24 bits, and Timer0 counts since
+   that pass began in the lower 8, so one unit is one Timer0 count (4 us at 16 Mhz, 8 us at 8 Mhz).
+   Taken in the ISR from a cached count and TCNT0 at a few cycles' cost, without micros().  Only the
+   difference of two stamps means anything; it is good for about 4.7 hours at 16 Mhz.  Edge times
+   are stamps -- but a pin is still only sampled once a tick (twice with SCHED_TWO_PHASE), so a stamp
+   says exactly when the sample was taken, not when between samples the edge came. */
+#define SCHED_STAMP_US(d)  ((d) * (64000000UL / F_CPU))    /* stamp difference to us -- up to an hour */
+#define SCHED_STAMP_MS(d)  ((d) / (F_CPU / 64000UL))       /* stamp difference to ms */
+
+/* Scheduler statistics, maintained by the ISR and copied out atomically by sched_get_stats().
+   Durations are in Timer0 counts (64 clocks -- 4 us at 16 Mhz, 8 us at 8 Mhz) and cover the
+   schedule maintenance only, not the register save and restore around it. */
+typedef struct
+{
+  unsigned long ticks;          /* ISR passes since sched_list_init() or sched_clear_stats() */
+  unsigned long isr_total;      /* sum of all ISR durations -- divide by ticks for the average */
+  unsigned char isr_last;       /* duration of the most recent pass */
+  unsigned char isr_max;        /* worst pass */
+  unsigned long deferred;       /* pin samples and analog steps put off to a later tick by the budget */
+  unsigned char work_last;      /* pin samples taken in the most recent pass */
+  unsigned char work_max;       /* ...and in the busiest -- what SCHED_STAGGER keeps down */
+  unsigned long peeks;          /* samples of idle pins replaced by a peek -- see sched_pin_idle() */
+  unsigned char lag_last;       /* SCHED_BACKEND_COOP: ticks the latest sched_service() found owed... */
+  unsigned char lag_max;        /* ...and the most any call has -- 1 when loop() keeps up */
+  unsigned long skipped;        /* SCHED_BACKEND_COOP: ticks given up beyond SCHED_COOP_CATCHUP */
+}
+sched_stats;
+
+/* Gated measurement of a pin -- see sched_measure_start() */
+#define SCHED_MEASURE_MAX  2      /* pins measured at once */
+
+typedef struct
+{
+  unsigned int edges;           /* rising edges in the gate */
+  unsigned long period_us;      /* mean time from one rising edge to the next, 0 if under 2 edges */
+  unsigned long freq_chz;       /* frequency from that period, in 0.01 Hz -- 2000 for 20 Hz */
+  unsigned char duty;           /* percent of samples HIGH */
+  unsigned int gates;           /* gates closed since the start -- changes when the figures do */
+}
+sched_measurement;
+
+/* Contact health of a pin -- see sched_bounce_watch() */
+#define SCHED_BOUNCE_MAX      2   /* pins watched at once */
+#define SCHED_BOUNCE_BUCKETS  8
+
+typedef struct
+{
+  unsigned int transitions;     /* debounced transitions seen */
+  unsigned long flips;          /* raw level flips seen, in all */
+  unsigned char worst;          /* most bounces on any one transition */
+  unsigned int hist[SCHED_BOUNCE_BUCKETS];   /* transitions by bounces: bucket 0 none, bucket b from
+                                                2^(b-1) up to 2^b - 1, last bucket everything more */
+}
+sched_bounce;
+
+#define SCHED_IDLE_MAX        2   /* adaptive pins at once -- see sched_pin_idle() */
+#define SCHED_LIFETIME_MAX    2   /* pins with lifetime counts at once -- see sched_pin_lifetime() */
+
+/* Priority classes -- see sched_set_priority() */
+#define SCHED_PRIO_CRITICAL  0
+#define SCHED_PRIO_NORMAL    1
+
 /* Note that volatile attribute is used because instances of this struct are handled by an interrupt. */
 typedef struct
 {
@@ -74,6 +323,20 @@ typedef struct
   volatile unsigned char recurring;
   volatile unsigned long schedtime;
   volatile unsigned long schedms;
+  volatile unsigned char prio;            /* SCHED_PRIO_... */
+  volatile unsigned char count_n;         /* count threshold, 0 for none -- see sched_pin_count_at() */
+  volatile unsigned char count_flags;
+#if SCHED_TWO_PHASE
+  volatile unsigned char phase2;          /* sampled by the COMPA pass too -- see sched_pin_two_phase() */
+#endif
+#if SCHED_EDGE_TIMES
+  volatile unsigned long rawedge_st;      /* first raw sample of latest transition -- a stamp */
+  volatile unsigned long edge_st;         /* confirmation of latest transition -- a stamp */
+  volatile unsigned char raw_quiet;       /* samples back at debounced level, 0xFF when no raw change pending */
+#endif
+#if SCHED_SHADOW_CHECK
+  sched_ref ref;
+#endif
 }
 sched;
 
@@ -118,15 +381,72 @@ extern "C"    /* begin C-only code */
 
   char sched_event(char ident, char recur, unsigned long ms);
 
+  char sched_event_phase(char ident, unsigned long ms, unsigned long phase);
+  /* As sched_event() for a recurring entry, but expiring whenever millis() modulo ms is phase (taken
+     modulo ms), rather than wherever SCHED_STAGGER puts it -- for lining up entries deliberately, or
+     spreading them by hand.  The first expiry comes within one period. */
+
   /* Cancel the timout for an identified scheduled event, while leaving its entry in place in the
      schedule list.
   */
 
   char sched_cancel(char ident);
 
+  /* Staged reconfiguration.  sched_list_init() stops all debouncing and analog scanning while it
+     empties the list, and sched_event() changes the live list under the running ISR.  To change pins,
+     timers or the analog channel set at run time instead:
+
+        sched_stage_begin(n, copy);       start a new list (empty, or a copy of the live one's entries)
+                                          scanning n analog ports -- LOW if a commit is still pending
+        sched_stage_event(ident, r, ms);  add or change an entry, exactly as sched_event() would
+        sched_stage_drop(ident);          remove an entry (LOW if there was none)
+        sched_stage_commit();             hand it over; sched_stage_pending() is HIGH until it is live
+
+     The ISR swaps the new list in between two ticks, so no tick is skipped or split between old and
+     new lists.  An ident present in both carries its live state across: a pin keeps its debounce
+     integrator, level, unread change and event counts, and a running timer with unchanged settings
+     keeps its phase (recurring) or the rest of its countdown (one-shot).  New pins start debounced
+     at their level when staged.  Calls on the live list made while a commit is pending act on the
+     outgoing list -- a swap due while one of them is under way waits a tick for it to finish.
+     Needs sched_list_init() first. */
+
+  char sched_stage_begin(unsigned char num_analogs_toscan, char copy);
+
+  char sched_stage_event(char ident, char recur, unsigned long ms);
+
+  char sched_stage_drop(char ident);
+
+  void sched_stage_commit(void);
+
+  char sched_stage_pending(void);
+
   unsigned int sched_analogread(unsigned char pin);   /* manual asynchronous read of analog port from preset
                                    buffer filled in by background process */
 
+  char sched_analog_pin(unsigned char ch, unsigned int lo, unsigned int hi);
+  /* Set the hysteresis thresholds (ADC counts, lo <= hi) of analog channel ch as a virtual pin, and
+     restart its level from the latest reading.  Register the pin itself with
+     sched_event(SCHED_ANALOG_PIN(ch),1,1) as for a digital one.  Returns LOW if refused. */
+
+  char sched_ladder(unsigned char ch, const unsigned int *bounds, unsigned char n);
+  /* Decode scanned analog channel ch as a ladder of n buttons (n <= SCHED_LADDER_MAX, 0 to remove the
+     ladder).  bounds[] holds strictly increasing ADC counts: a reading below bounds[0] is button 0,
+     from bounds[b-1] up to below bounds[b] is button b, and from bounds[n-1] up is no button (the
+     pull-up alone).  Put each bound midway between neighbouring buttons' nominal readings.  Then
+     register the buttons wanted with sched_event(SCHED_LADDER_PIN(b),1,1).  Returns LOW if refused. */
+
+  char sched_pin_hwcount(char ident, char level, unsigned char holdoff);
+  /* Count pulses on pin ident, which must be SCHED_T1_PIN and registered with sched_event(ident,1,1),
+     with Timer1 instead of by sampling -- edges to level are counted by the hardware, and the ISR
+     no longer samples the pin.  With holdoff 0 every edge counts, so the contact needs an RC filter,
+     and sched_pin_event_count() reads TCNT1 directly.  Otherwise the ISR checks TCNT1 once a tick and
+     counts one event per burst of edges, ignoring any within holdoff ms after it.  Either way both
+     levels give the same count, and sched_pin_level(), gohigh() and golow() are not kept up for the
+     pin.  ident -1 stops the counting.  Takes Timer1 from analogWrite() on pins 9 and 10 and from
+     libraries such as Servo.  Returns LOW if refused (wrong pin, or no T1 on this chip). */
+
+  unsigned long sched_stamp(void);   /* sub-tick stamp of right now -- see SCHED_STAMP_US() */
+
   char sched_check(char ident);   /* Manual asynchronous check of ID'd schedule --
                                  return value HIGH means timeout was reached. */
 
@@ -140,6 +460,64 @@ extern "C"    /* begin C-only code */
   char sched_pin_golow(char ident);   /* Manual asynchronous check of ID'd (debounced) pin change HIGH to LOW
                                       returns HIGH on leading edge of change HIGH to LOW on associated pin. */
 
+  char sched_pin_idle(char ident, unsigned int idle_ms, unsigned char slow_ms);
+  /* Adaptive sampling for ID'd digital pin: once it has been stable for idle_ms samples (ms, for a
+     pin sampled every ms) it goes idle, and the ISR only peeks at its bit in the input register
+     instead of the full digitalRead() and integrator step -- with a full sample every slow_ms ticks.
+     The first tick the peek sees the pin differ wakes it and takes the full sample there and then,
+     so a first edge is seen no later than before; it goes idle again after another idle_ms stable
+     samples.  Idle pins are not skipped while a measurement (sched_measure_start()) is running.
+     idle_ms 0 stops.  Returns LOW if not a digital pin, or all SCHED_IDLE_MAX entries are in use. */
+
+  char sched_pin_lifetime(char ident, char on);
+  /* Start (on nonzero, from zero) or stop keeping lifetime counts of ID'd pin's transitions each
+     way, as sched_pin_event_count() counts them but 32 bits wide and never reset by reading --
+     for usage metering.  The ISR only bumps a 16-bit low word and counts its carries; the high word
+     is brought up to date by sched_pin_lifetime_count(), which must be called at least once every
+     255 wraps (some 16 million transitions) to stay exact.  A pin counted by Timer1 without a
+     holdoff is counted from TCNT1 every tick.  Returns LOW if not a pin, or all SCHED_LIFETIME_MAX
+     entries are in use. */
+
+  unsigned long sched_pin_lifetime_count(char ident, char level);
+  /* Consistent 32-bit lifetime count of ID'd pin's transitions to level, 0 if the pin has none. */
+
+  char sched_bounce_watch(char ident, char on);
+  /* Start (on nonzero, clearing the statistics) or stop keeping contact health statistics for ID'd
+     pin.  The ISR counts the pin's raw level flips, and at each debounced transition files those
+     beyond the one the transition needed as its bounces -- glitches the integrator rode out count
+     toward the next transition.  A clean contact stays in bucket 0; a worn one creeps up the
+     histogram long before it misdials.  Returns LOW if not a pin, or all SCHED_BOUNCE_MAX entries
+     are in use. */
+
+  char sched_bounce_read(char ident, sched_bounce *st, char reset);
+  /* Consistent copy of ID'd pin's contact health statistics, cleared afterwards if reset is
+     nonzero -- returns LOW if the pin is not watched. */
+
+  char sched_measure_start(char ident, unsigned int gate_ms, char raw);
+  /* Measure ID'd pin (already registered with sched_event()) over a gate of gate_ms, repeated for
+     as long as it runs -- rising edges, their mean period (from edge stamps, so not limited to a
+     whole number of edges per gate), and duty cycle.  raw nonzero takes each raw sample instead of
+     the debounced level, for signals faster than the debounce -- e.g. 20 or 25 Hz ringing, sampled
+     every 1 ms.  gate_ms 0 stops it.  Returns LOW if not a pin, or all SCHED_MEASURE_MAX entries are
+     in use. */
+
+  char sched_measure_read(char ident, sched_measurement *m);
+  /* Figures from the last gate closed on ID'd pin -- returns LOW if not measured, or no gate has
+     closed yet. */
+
+  char sched_pin_count_at(char ident, char level, unsigned char n);
+  /* Have the ISR watch ID'd pin's count of transitions to level (as sched_pin_event_count() gives it)
+     and raise a flag when it reaches n -- e.g. n = 1 for "first pulse seen", 10 for a full "0".
+     n = 0 stops watching.  The flag is raised once per run of counts: after it has been seen, it
+     comes again only once the count has been reset below n.  Returns LOW if no such pin. */
+
+  char sched_pin_count_ready(char ident);
+  /* HIGH, once, when ID'd pin's count has reached its threshold -- a flag test, costing nothing
+     until then. */
+
+  char sched_pin_change(char ident);   /* Manual asynchronous check of ID'd (debounced) pin change either way
+                                      returns -1 if no change since last checked, else the level changed to. */
+
   char sched_pin_level(char ident, char level);   /* Manual asynchronous check of ID'd debounce pin level
                                                 returns HIGH or LOW for current (debounced) level seen. */
 
@@ -147,6 +525,77 @@ extern "C"    /* begin C-only code */
                                          to process background events, but is now included in interrupt service 
                                          routine (ISR). */
 
+  void sched_service(void);   /* Run the ticks due since the last call -- with SCHED_BACKEND_COOP, call once per
+                                 pass of the user event loop (at least once per ms to keep 1 ms sampling).
+                                 Does nothing with the ISR backend, so a sketch may call it either way. */
+
+#if SCHED_EDGE_TIMES
+  char sched_pin_edge_times(char ident, unsigned long *rawedge, unsigned long *confirm);
+  /* Stamps (see sched_stamp()) of the first raw sample, and of the debounced confirmation, of the
+     most recent transition on ID'd pin.  Returns the new level of that transition, or -1 if no such
+     pin. */
+#endif
+
+  char sched_set_debounce(char up, char down, char max);
+  /* Set the debounce integrator thresholds for all pins (defaults 15, 5, 20).  Each 1 ms sample counts
+     toward max when HIGH and toward 0 when LOW; the debounced level goes HIGH above up and LOW below
+     down.  Requires 0 < down < up < max <= 100 -- returns HIGH if accepted, LOW (and no change) if not.
+     Takes effect from the next sample.  All three 0 restores the defaults. */
+
+  void sched_get_debounce(char *up, char *down, char *max);   /* thresholds now in use */
+
+  /* Each tick the ISR samples the SCHED_PRIO_CRITICAL pins first, unconditionally, then the
+     SCHED_PRIO_NORMAL pins (the default) and finally the background analog scan -- but only while
+     the ISR has used less than the budget set by sched_set_budget().  Work left over goes to the next
+     tick (a normal pin misses that one sample; the analog scan just falls a step behind), is counted
+     in sched_stats.deferred, and the next tick's normal pass starts with the pin that was put off.
+     With no budget (0, the default) everything is done every tick.  sched_set_priority() acts on the
+     live list and on any list being staged; staged entries otherwise start at SCHED_PRIO_NORMAL, or
+     with their live priority when staged as a copy. */
+
+  char sched_set_priority(char ident, unsigned char prio);   /* returns LOW if no such ident or class */
+
+#if SCHED_TWO_PHASE
+  char sched_pin_two_phase(char ident, char on);
+  /* Sample digital pin ident in the COMPA pass as well (on nonzero) or not -- see SCHED_TWO_PHASE.
+     Only a pin registered with a 0 or 1 ms period gets the second sample.  Acts on the live list and
+     on any list being staged, as sched_set_priority() does.  Returns LOW if no such pin, or if it is
+     the pin Timer1 counts for sched_pin_hwcount(). */
+#endif
+
+  void sched_set_budget(unsigned char counts);   /* Timer0 counts, as the ISR durations in sched_stats */
+
+  void sched_get_stats(sched_stats *st);   /* consistent copy of the scheduler statistics */
+
+  void sched_clear_stats(void);   /* restart the statistics */
+
+#if SCHED_SHADOW_CHECK
+  char sched_shadow_status(sched_divergence *div);   /* returns HIGH if the live engine has disagreed with the
+                                                        reference since the last clear; first divergence copied
+                                                        to *div (may be NULL). */
+
+  void sched_shadow_clear(void);   /* forget any latched divergence and resume checking */
+
+  unsigned long sched_shadow_selftest(unsigned long seed, unsigned long steps);
+  /* Run live engine and reference side by side on a scratch slot for the given number of pseudo-random
+     steps (pin samples, undebounced samples, count resets, change checks).  Returns 0 if they agreed
+     throughout, else the 1-based step of the first divergence, which is also latched as above.
+     Blocks for the duration -- a few ms per thousand steps -- so call it from setup() or a bench sketch. */
+#endif
+
+#if SCHED_TRACE
+  void sched_trace_mark(unsigned char code);   /* add a user marker record to the trace */
+
+  unsigned char sched_trace_read(unsigned char *buf, unsigned char max, unsigned long *base, unsigned char *dropped);
+  /* Remove whole records (at most max bytes) from the trace into buf, returning the byte count.
+     *base is set to the millis() time the first record's delta counts from, *dropped to the number of
+     records lost to overwriting since the previous read. */
+
+  void sched_trace_dump(void (*putbyte)(unsigned char));   /* drain the trace as framed records -- see above */
+
+  void sched_trace_clear(void);   /* empty the trace and restart the worst-case ISR duration */
+#endif
+
 }             /* end C-only code */
 
 #endif   /* ... of __GLF_SCHED_INT_H__ */
@@ -0,0 +1,160 @@
+/* glf_softuart library                17 Oct 2026 agent
+
+   Interrupt-driven, transmit-only software UART for the ATtiny85 -- see glf_softuart.h.
+
+*/
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include "WProgram.h"
+#endif
+
+#include "glf_softuart.h"
+
+#if(defined(__ATtinyX5__))
+
+extern "C"    /* begin C-only code */
+{
+
+#define SUART_TX_MASK (SUART_TX_SIZE - 1)
+
+#define SUART_COM_MASK  ((1 << COM1A1) | (1 << COM1A0))
+#define SUART_COM_HIGH  ((1 << COM1A1) | (1 << COM1A0))   /* set OC1A on next compare match */
+#define SUART_COM_LOW   (1 << COM1A1)                     /* clear OC1A on next compare match */
+
+  static unsigned char suart_ring[SUART_TX_SIZE];
+  static unsigned char suart_head = 0;                 /* next byte to be written -- event loop only */
+  static volatile unsigned char suart_tail = 0;        /* next byte to be sent -- ISR only */
+  static volatile unsigned char suart_used = 0;
+  static volatile unsigned int suart_shift = 0;        /* bits still to go, LSB first */
+  static volatile unsigned char suart_bits = 0;        /* how many */
+
+
+  void suart_begin(unsigned long baud)
+  {
+    unsigned long ticks;
+    unsigned char cs = 1;      /* CS13:0 -- 1 is CK, each step up halves the clock */
+
+    ticks = (F_CPU + (baud / 2)) / baud;
+
+    while ((ticks > 256) && (cs < 15))
+      {
+        ticks = (ticks + 1) >> 1;
+        cs++;
+      }
+
+    TIMSK &= ~(1 << OCIE1A);
+
+    suart_head = 0;
+    suart_tail = 0;
+    suart_used = 0;
+    suart_bits = 0;
+
+    /* OC1A must be set before it is made an output, or the line glitches low */
+    TCCR1 = 0;
+    GTCCR &= ~((1 << PWM1B) | (1 << COM1B1) | (1 << COM1B0));
+    TCCR1 = SUART_COM_HIGH;
+    GTCCR |= (1 << FOC1A);      /* force a compare -- OC1A goes high now */
+
+    DDRB |= (1 << PB1);
+
+    TCNT1 = 0;
+    OCR1A = ticks - 1;          /* bit boundaries come at the top of each period */
+    OCR1C = ticks - 1;          /* CTC top -- the period is OCR1C + 1 counts */
+    TCCR1 = (1 << CTC1) | SUART_COM_HIGH | cs;
+  }
+
+
+  /* Called at each bit boundary while sending -- the level chosen here goes onto the line at the
+     NEXT boundary, by hardware, so this may run late by anything up to one bit time. */
+
+  ISR(TIM1_COMPA_vect)
+  {
+    unsigned char com;
+
+    if (!suart_bits)
+      {
+        if (!suart_used)
+          {
+            /* ring empty -- line stays high, and no more interrupts until suart_write() */
+            TIMSK &= ~(1 << OCIE1A);
+            return;
+          }
+
+        /* next byte -- start bit goes out at the next boundary, then 8 data bits LSB first and a
+           stop bit */
+        suart_shift = suart_ring[suart_tail] | 0x100;
+        suart_tail = (suart_tail + 1) & SUART_TX_MASK;
+        suart_used--;
+        suart_bits = 9;
+        com = SUART_COM_LOW;
+      }
+    else
+      {
+        com = (suart_shift & 1) ? SUART_COM_HIGH : SUART_COM_LOW;
+        suart_shift >>= 1;
+        suart_bits--;
+      }
+
+    TCCR1 = (TCCR1 & ~SUART_COM_MASK) | com;
+  }
+
+
+  char suart_write(unsigned char c)
+  {
+    unsigned char oldSREG;
+
+    if (suart_used >= SUART_TX_SIZE)
+      {
+        return 0;
+      }
+
+    suart_ring[suart_head] = c;
+    suart_head = (suart_head + 1) & SUART_TX_MASK;
+
+    oldSREG = SREG;
+    cli();
+    suart_used++;
+
+    if (!(TIMSK & (1 << OCIE1A)))
+      {
+        /* idle -- wake the ISR; it starts the byte at the boundary after the next one */
+        TIFR = (1 << OCF1A);     /* forget any stale match */
+        TIMSK |= (1 << OCIE1A);
+      }
+
+    SREG = oldSREG;
+
+    return 1;
+  }
+
+
+  int suart_room(void)
+  {
+    return SUART_TX_SIZE - suart_used;
+  }
+
+
+  void suart_putbyte(unsigned char c)
+  {
+    suart_write(c);
+  }
+
+
+  unsigned char suart_pending(void)
+  {
+    unsigned char n;
+    unsigned char oldSREG;
+
+    oldSREG = SREG;
+    cli();
+    n = suart_used + (suart_bits ? 1 : 0);
+    SREG = oldSREG;
+
+    return n;
+  }
+
+}             /* end C-only code */
+
+#endif   /* ... of __ATtinyX5__ */
@@ -0,0 +1,54 @@
+/* glf_softuart library                17 Oct 2026 agent
+
+   Interrupt-driven, transmit-only software UART for the ATtiny85, which has no hardware UART.
+
+   SoftwareSerial times each bit with a delay loop and interrupts off, a whole character at a time --
+   at 9600 baud that shuts glf_scheduler's Timer0 ISR out for a millisecond and more, and debounce
+   ticks are lost.  Here Timer1 runs in CTC mode at the bit rate, and the compare-match hardware
+   drives the OC1A pin (PB1) to the next bit level exactly on each bit boundary.  The TIM1_COMPA
+   interrupt only has to choose that level some time during the bit before, so neither the scheduler
+   ISR (which runs with interrupts enabled) nor the core's millis() ISR can put jitter on the line,
+   as long as no interrupt holds the CPU for a whole bit time.  57600 baud at 8 MHz leaves 138 cycles
+   per bit, which is comfortable.
+
+   Bytes wait in a RAM ring and suart_write() never blocks -- a byte is refused if the ring is full.
+   suart_room() and suart_putbyte() fit telem_begin() directly.
+
+   Format is N81, idle high.  Timer1 is taken over completely, so analogWrite() on PB1 and PB4 is
+   lost, and PB1 becomes the TX output.  On other parts the library compiles to nothing.
+
+*/
+
+#ifndef __GLF_SOFTUART_H__
+#define __GLF_SOFTUART_H__ 1
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include "WProgram.h"
+#endif
+
+
+#define SUART_TX_SIZE  32     /* bytes in TX ring -- power of 2, at most 128 */
+
+
+extern "C"    /* begin C-only code */
+{
+
+#if(defined(__ATtinyX5__))
+  void suart_begin(unsigned long baud);
+  /* Take over Timer1 and PB1 and set the bit rate -- anything from F_CPU/16384/256 up to about
+     57600 at 8 MHz.  Line idles high. */
+
+  char suart_write(unsigned char c);   /* queue one byte -- returns HIGH if queued, LOW if ring full */
+
+  int suart_room(void);                /* bytes suart_write() will accept right now */
+
+  void suart_putbyte(unsigned char c); /* suart_write() without the result, for telem_begin() */
+
+  unsigned char suart_pending(void);   /* bytes not yet fully sent, including the one on the line */
+#endif
+
+}             /* end C-only code */
+
+#endif   /* ... of __GLF_SOFTUART_H__ */
@@ -0,0 +1,56 @@
+#!/bin/sh
+# Host checks for glf_telemetry -- builds the library with g++ against the stand-in core in
+# glf_scheduler/extras/host/mock and runs:
+#
+#   parse   three devices' streams from telem_feed, each with frames lost and damaged on the way,
+#           fed through FIFOs to one telem_parse at once.  Every stream must come out as its clean
+#           copy parsed alone, less the damaged frames, and end with the counts telem_feed expects.
+#
+# usage: run.sh [records]      (default 5000 per stream)
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+LIB=$(cd "$HERE/../.." && pwd)
+MOCK=$(cd "$LIB/../glf_scheduler/extras/host/mock" && pwd)
+OUT=${OUT:-${TMPDIR:-/tmp}/glf_telemetry_host}
+CXX=${CXX:-g++}
+CXXFLAGS="-std=gnu++11 -O1 -DARDUINO=106 -I$MOCK -I$LIB"
+RECORDS=${1:-5000}
+STREAMS="0 1 2"
+
+mkdir -p "$OUT"
+
+$CXX $CXXFLAGS -o "$OUT/telem_parse" "$HERE/telem_parse.cpp"
+$CXX $CXXFLAGS -o "$OUT/telem_feed" "$MOCK/mock.cpp" "$LIB/glf_telemetry.cpp" "$HERE/telem_feed.cpp"
+
+for i in $STREAMS
+do
+  rm -f "$OUT/dev$i"
+  mkfifo "$OUT/dev$i"
+  "$OUT/telem_feed" $((i + 1)) $RECORDS "$OUT/clean$i.bin" "$OUT/damage$i.txt" > "$OUT/dev$i" &
+done
+
+"$OUT/telem_parse" "$OUT/dev0" "$OUT/dev1" "$OUT/dev2" > "$OUT/parsed.txt"
+wait
+
+for i in $STREAMS
+do
+  "$OUT/telem_parse" "$OUT/clean$i.bin" > "$OUT/clean$i.txt"
+
+  awk 'NR == FNR { if ($1 == "end") end = $0; else skip[$1 + 1] = 1; next }
+       $2 == "end" { print "0 " end; next }
+       !skip[FNR]' "$OUT/damage$i.txt" "$OUT/clean$i.txt" > "$OUT/expect$i.txt"
+  grep "^$i " "$OUT/parsed.txt" | sed "s/^$i /0 /" > "$OUT/got$i.txt"
+
+  if ! cmp -s "$OUT/expect$i.txt" "$OUT/got$i.txt"
+  then
+    echo "parse: stream $i is not what was sent (< expected, > parsed):"
+    diff "$OUT/expect$i.txt" "$OUT/got$i.txt" | head -20
+    exit 1
+  fi
+
+  echo "parse: stream $i -- $(tail -1 "$OUT/got$i.txt" | cut -d' ' -f2-)"
+done
+
+rm -f "$OUT/dev0" "$OUT/dev1" "$OUT/dev2"
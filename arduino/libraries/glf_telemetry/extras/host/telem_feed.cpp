@@ -0,0 +1,292 @@
+/* Host telemetry feed -- one device's stream for telem_parse to read, made by the library itself:
+   telem_send() and telem_service(), with the output taking a few bytes at a time as a busy UART
+   would.  Records are the standard types, their bodies laid out byte by byte as the AVR lays out the
+   structs (the host's own structs are not the same), and application types with random bodies from
+   0 to TELEM_MAX_BODY bytes, plenty of them zeros.
+
+   Usage: telem_feed seed records clean damage > stream
+
+   stream   what went down the link -- every frame numbered 50 mod 97 lost outright, and every one
+            numbered 40 mod 89 with the byte before its delimiter flipped (frames counted from 0 in
+            the order they were queued)
+   clean    the same frames, none of them damaged
+   damage   the numbers of the damaged frames, one per line, then the line telem_parse must end the
+            stream with, as "end frames <n> bad <n> gaps <n> lost <n>"
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "glf_telemetry.h"
+
+static unsigned long tf_seed;
+static FILE *tf_out;
+static FILE *tf_clean;
+static unsigned long tf_frame;     /* frame the next byte out belongs to */
+static unsigned char tf_held[TELEM_MAX_BODY + 5];
+static unsigned char tf_n;
+
+
+static unsigned int tf_rand(unsigned int n)     /* 0 to n-1 */
+{
+  tf_seed = tf_seed * 1103515245UL + 12345UL;
+  return (unsigned int)((tf_seed >> 16) & 0x7FFF) % n;
+}
+
+
+static char tf_lost(unsigned long k)
+{
+  return ((k % 97) == 50);
+}
+
+
+static char tf_flipped(unsigned long k)
+{
+  return ((k % 89) == 40) && !tf_lost(k);
+}
+
+
+static int tf_room(void)
+{
+  return tf_rand(8);
+}
+
+
+/* The output -- a frame is held until its delimiter so it can be damaged whole */
+
+static void tf_put(unsigned char c)
+{
+  tf_held[tf_n++] = c;
+
+  if (c)
+    {
+      return;
+    }
+
+  fwrite(tf_held, 1, tf_n, tf_clean);
+
+  if (tf_flipped(tf_frame))
+    {
+      tf_held[tf_n - 2] ^= (tf_held[tf_n - 2] == 1) ? 2 : 1;     /* never to 0x00 */
+    }
+
+  if (!tf_lost(tf_frame))
+    {
+      fwrite(tf_held, 1, tf_n, tf_out);
+    }
+
+  tf_n = 0;
+  tf_frame++;
+}
+
+
+static void tf_u16(unsigned char *p, unsigned int v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+}
+
+
+static void tf_u32(unsigned char *p, unsigned long v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+
+/* One record's body in b, returning its type and *len */
+
+static unsigned char tf_body(unsigned char *b, unsigned char *len, unsigned long ms)
+{
+  unsigned char i;
+  const char *t;
+  static const char *const text[] = { "GLF pulsedial_key -- Arduino", "ok", "timeout 5000", "" };
+
+  switch (tf_rand(12))
+    {
+      case 0:
+        t = text[tf_rand(4)];
+
+        for (i=0; t[i] && (i < TELEM_MAX_BODY); i++)
+          {
+            b[i] = t[i];
+          }
+
+        *len = i;
+        return TELEM_TEXT;
+
+      case 1:
+      case 2:
+        tf_u32(b, ms);
+        b[4] = tf_rand(10);
+        b[5] = b[4] ? b[4] : 10;
+        *len = 6;
+        return TELEM_DIGIT;
+
+      case 3:
+        tf_u32(b, ms);
+        *len = 4;
+        return TELEM_EOL;
+
+      case 4:
+        tf_u32(b, ms);
+
+        for (i=0; i<4; i++)
+          {
+            tf_u16(b + 4 + 2 * i, tf_rand(3) ? tf_rand(300) : 0);
+          }
+
+        *len = 12;
+        return TELEM_DIAL_STATS;
+
+      case 5:
+        tf_u32(b, ms);
+        tf_u32(b + 4, ms - 1000);
+        tf_u32(b + 8, (ms - 1000) * 23);
+        b[12] = 20 + tf_rand(5);
+        b[13] = 40;
+        tf_u16(b + 14, tf_rand(2));
+        tf_u32(b + 16, tf_rand(70000));
+        b[20] = tf_rand(8);
+        b[21] = 0;
+        *len = 22;
+        return TELEM_SCHED_STATS;
+
+      case 6:
+        tf_u32(b, ms - 40);
+        b[4] = 0;
+        *len = 5 + 3 * tf_rand(9);
+
+        for (i=5; i<*len; i+=3)
+          {
+            b[i] = 0x11;
+            b[i + 1] = tf_rand(0x80);
+            b[i + 2] = 2 + tf_rand(6);
+          }
+
+        return TELEM_TRACE;
+
+      case 7:
+        b[0] = tf_rand(5);
+
+        for (i=0; i<TELEM_LAT_BUCKETS; i++)
+          {
+            tf_u16(b + 1 + 2 * i, tf_rand(2) ? tf_rand(1000) : 0);
+          }
+
+        *len = 1 + 2 * TELEM_LAT_BUCKETS;
+        return TELEM_LATENCY;
+
+      case 8:
+        b[0] = 6 + tf_rand(2);
+        tf_u16(b + 1, tf_rand(400));
+        b[3] = tf_rand(20);
+
+        for (i=0; i<TELEM_BOUNCE_BUCKETS; i++)
+          {
+            tf_u16(b + 4 + 2 * i, tf_rand(2) ? tf_rand(300) : 0);
+          }
+
+        *len = 4 + 2 * TELEM_BOUNCE_BUCKETS;
+        return TELEM_BOUNCE;
+
+      case 9:
+        tf_u32(b, ms);
+        tf_u32(b + 4, 100000 + ms / 7);
+        tf_u32(b + 8, 9000 + ms / 70);
+        *len = 12;
+        return TELEM_USAGE;
+
+      default:
+        *len = tf_rand(TELEM_MAX_BODY + 1);
+
+        for (i=0; i<*len; i++)
+          {
+            b[i] = tf_rand(3) ? tf_rand(256) : 0;
+          }
+
+        return 0x80 + tf_rand(4);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+  unsigned char body[TELEM_MAX_BODY];
+  unsigned char len;
+  unsigned char type;
+  unsigned long records;
+  unsigned long k;
+  unsigned long damaged = 0;
+  unsigned long bad = 0;
+  unsigned long gaps = 0;
+  unsigned long tail = 0;      /* damaged frames at the very end */
+  FILE *damage;
+
+  if (argc < 5)
+    {
+      fprintf(stderr, "usage: telem_feed seed records clean damage > stream\n");
+      return 2;
+    }
+
+  tf_seed = strtoul(argv[1], NULL, 0);
+  records = strtoul(argv[2], NULL, 0);
+  tf_out = stdout;
+  tf_clean = fopen(argv[3], "wb");
+  damage = fopen(argv[4], "w");
+
+  if (!tf_clean || !damage)
+    {
+      perror("telem_feed");
+      return 2;
+    }
+
+  telem_begin(tf_room, tf_put);
+
+  for (k=0; k<records; k++)
+    {
+      type = tf_body(body, &len, 1000 + 37 * k);
+
+      while (!telem_send(type, body, len))
+        {
+          telem_service();      /* ring full -- a sketch would have dropped it, here it waits */
+        }
+
+      telem_service();
+    }
+
+  while (telem_pending())
+    {
+      telem_service();
+    }
+
+  /* what the parser must make of it -- a run of damaged frames is one gap, once a good frame ends it */
+  for (k=0; k<records; k++)
+    {
+      if (tf_lost(k) || tf_flipped(k))
+        {
+          fprintf(damage, "%lu\n", k);
+          damaged++;
+          bad += tf_flipped(k);
+          gaps += !tail;
+          tail++;
+        }
+      else
+        {
+          tail = 0;
+        }
+    }
+
+  if (tail)
+    {
+      gaps--;       /* nothing after the last run to show it */
+    }
+
+  fprintf(damage, "end frames %lu bad %lu gaps %lu lost %lu\n", records - damaged, bad, gaps, damaged - tail);
+  fclose(damage);
+  fclose(tf_clean);
+
+  return 0;
+}
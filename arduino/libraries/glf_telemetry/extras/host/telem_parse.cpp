@@ -0,0 +1,345 @@
+/* Host parser for glf_telemetry streams -- any number of devices at once, one file, FIFO or serial
+   port each, read as the bytes arrive (poll()) and printed one line per record:
+
+      <stream> <seq> <type> <fields...>
+
+   where stream is the device's place on the command line, counting from 0.  The standard record
+   types are decoded field by field from their AVR layout (glf_telemetry.h) -- the host's own structs
+   are laid out differently, so bodies are never copied into them -- and anything else, or a
+   standard type of the wrong length, is printed as hex.  When a stream ends:
+
+      <stream> end frames <n> bad <n> gaps <n> lost <n>
+
+   bad counts frames which would not decode (COBS, sum, too short or too long), gaps the breaks in the
+   sequence numbers and lost the records those breaks skipped -- damaged frames included, since their
+   sequence number cannot be trusted.  Frames telem_send() dropped for lack of TX room leave no gap;
+   the device counts those itself (telem_dropped()).
+
+   Usage: telem_parse stream...
+
+   Frames are split on 0x00 and COBS-decoded in place in the read buffer, so a record is never
+   copied on its way to being printed -- only the unfinished frame at the end of a read is moved to
+   the front of the buffer to meet the rest of it.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "glf_telemetry.h"
+
+#define TP_STREAMS_MAX  16
+#define TP_FRAME_MAX    (TELEM_MAX_BODY + 5)   /* longest encoded frame, delimiter included */
+#define TP_BUF          256
+
+typedef struct
+{
+  int fd;
+  unsigned char buf[TP_BUF];
+  unsigned int len;             /* bytes in buf, from the start of the unfinished frame */
+  unsigned char skipping;       /* discarding up to the next 0x00 after an overlong frame */
+  unsigned char seq_known;
+  unsigned char seq_next;
+  unsigned long frames;
+  unsigned long bad;
+  unsigned long gaps;
+  unsigned long lost;
+}
+tp_stream;
+
+static tp_stream tp_list[TP_STREAMS_MAX];
+
+
+static unsigned int tp_u16(const unsigned char *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+
+static unsigned long tp_u32(const unsigned char *p)
+{
+  return p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+
+/* COBS decode the n bytes at buf over themselves -- the output never gets ahead of the input.
+   Returns the decoded length, -1 if the encoding is broken. */
+
+static int tp_cobs(unsigned char *buf, unsigned int n)
+{
+  unsigned int src = 0;
+  unsigned int dst = 0;
+  unsigned char code;
+  unsigned char j;
+
+  while (src < n)
+    {
+      code = buf[src++];
+
+      if (!code)
+        {
+          return -1;
+        }
+
+      for (j=1; j<code; j++)
+        {
+          if (src >= n)
+            {
+              return -1;
+            }
+
+          buf[dst++] = buf[src++];
+        }
+
+      if ((code < 0xFF) && (src < n))
+        {
+          buf[dst++] = 0;
+        }
+    }
+
+  return dst;
+}
+
+
+static void tp_hex(const unsigned char *body, unsigned int n)
+{
+  unsigned int i;
+
+  for (i=0; i<n; i++)
+    {
+      printf(" %02x", body[i]);
+    }
+}
+
+
+static void tp_record(int id, unsigned char seq, unsigned char type, const unsigned char *b, unsigned int n)
+{
+  unsigned int i;
+
+  printf("%d %u ", id, seq);
+
+  if (type == TELEM_TEXT)
+    {
+      printf("text %.*s\n", (int)n, (const char *)b);
+    }
+  else if ((type == TELEM_DIGIT) && (n == 6))
+    {
+      printf("digit ms %lu digit %u pulses %u\n", tp_u32(b), b[4], b[5]);
+    }
+  else if ((type == TELEM_EOL) && (n == 4))
+    {
+      printf("eol ms %lu\n", tp_u32(b));
+    }
+  else if ((type == TELEM_DIAL_STATS) && (n == 12))
+    {
+      printf("dial ms %lu digits %u numbers %u overruns %u empties %u\n", tp_u32(b), tp_u16(b + 4),
+             tp_u16(b + 6), tp_u16(b + 8), tp_u16(b + 10));
+    }
+  else if ((type == TELEM_SCHED_STATS) && (n == 22))
+    {
+      printf("sched ms %lu ticks %lu isr_total %lu isr_last %u isr_max %u dropped %u deferred %lu"
+             " work_max %u lag_max %u\n", tp_u32(b), tp_u32(b + 4), tp_u32(b + 8), b[12], b[13],
+             tp_u16(b + 14), tp_u32(b + 16), b[20], b[21]);
+    }
+  else if ((type == TELEM_TRACE) && (n >= 5))
+    {
+      printf("trace base %lu dropped %u records", tp_u32(b), b[4]);     /* as sched_trace_read() gave them */
+      tp_hex(b + 5, n - 5);
+      printf("\n");
+    }
+  else if ((type == TELEM_LATENCY) && (n == (1 + 2 * TELEM_LAT_BUCKETS)))
+    {
+      printf("latency stage %u", b[0]);
+
+      for (i=0; i<TELEM_LAT_BUCKETS; i++)
+        {
+          printf(" %u", tp_u16(b + 1 + 2 * i));
+        }
+
+      printf("\n");
+    }
+  else if ((type == TELEM_BOUNCE) && (n == (4 + 2 * TELEM_BOUNCE_BUCKETS)))
+    {
+      printf("bounce pin %u transitions %u worst %u", b[0], tp_u16(b + 1), b[3]);
+
+      for (i=0; i<TELEM_BOUNCE_BUCKETS; i++)
+        {
+          printf(" %u", tp_u16(b + 4 + 2 * i));
+        }
+
+      printf("\n");
+    }
+  else if ((type == TELEM_USAGE) && (n == 12))
+    {
+      printf("usage ms %lu pulses %lu dialings %lu\n", tp_u32(b), tp_u32(b + 4), tp_u32(b + 8));
+    }
+  else
+    {
+      printf("0x%02x", type);
+      tp_hex(b, n);
+      printf("\n");
+    }
+}
+
+
+/* One frame of stream id, delimiter stripped: type seq <body> sum once decoded */
+
+static void tp_frame(int id, tp_stream *s, unsigned char *f, unsigned int n)
+{
+  unsigned char sum = 0;
+  unsigned char seq;
+  int m;
+  int i;
+
+  m = tp_cobs(f, n);
+
+  if (m >= 3)
+    {
+      for (i=0; i<(m - 1); i++)
+        {
+          sum += f[i];
+        }
+    }
+
+  if ((m < 3) || (sum != f[m - 1]))
+    {
+      s->bad++;
+      return;
+    }
+
+  seq = f[1];
+
+  if (s->seq_known && (seq != s->seq_next))
+    {
+      s->gaps++;
+      s->lost += (unsigned char)(seq - s->seq_next);
+    }
+
+  s->seq_known = 1;
+  s->seq_next = seq + 1;
+  s->frames++;
+
+  tp_record(id, seq, f[0], f + 2, m - 3);
+}
+
+
+/* Take every whole frame out of what stream id has read so far */
+
+static void tp_scan(int id, tp_stream *s)
+{
+  unsigned int start = 0;
+  unsigned int i;
+
+  for (i=0; i<s->len; i++)
+    {
+      if (s->buf[i])
+        {
+          continue;
+        }
+
+      if (s->skipping)
+        {
+          s->skipping = 0;
+        }
+      else if (i > start)
+        {
+          tp_frame(id, s, s->buf + start, i - start);
+        }
+
+      start = i + 1;
+    }
+
+  if (s->skipping || ((s->len - start) >= TP_FRAME_MAX))
+    {
+      /* no frame is this long -- lost its delimiter, or not telemetry at all */
+      if (!s->skipping)
+        {
+          s->bad++;
+          s->skipping = 1;
+        }
+
+      s->len = 0;
+      return;
+    }
+
+  memmove(s->buf, s->buf + start, s->len - start);
+  s->len -= start;
+}
+
+
+int main(int argc, char **argv)
+{
+  struct pollfd pfd[TP_STREAMS_MAX];
+  tp_stream *s;
+  int open_n;
+  int n;
+  int i;
+  ssize_t got;
+
+  n = argc - 1;
+
+  if ((n < 1) || (n > TP_STREAMS_MAX))
+    {
+      fprintf(stderr, "usage: telem_parse stream...   (1 to %d of them)\n", TP_STREAMS_MAX);
+      return 2;
+    }
+
+  for (i=0; i<n; i++)
+    {
+      s = &tp_list[i];
+
+      if ((s->fd = open(argv[i + 1], O_RDONLY)) < 0)
+        {
+          perror(argv[i + 1]);
+          return 2;
+        }
+
+      pfd[i].fd = s->fd;
+      pfd[i].events = POLLIN;
+    }
+
+  open_n = n;
+
+  while (open_n)
+    {
+      if (poll(pfd, n, -1) < 0)
+        {
+          perror("poll");
+          return 2;
+        }
+
+      for (i=0; i<n; i++)
+        {
+          if ((pfd[i].fd < 0) || !pfd[i].revents)
+            {
+              continue;
+            }
+
+          s = &tp_list[i];
+          got = read(s->fd, s->buf + s->len, TP_BUF - s->len);
+
+          if (got <= 0)
+            {
+              /* whatever is left never got its delimiter */
+              if (s->len && !s->skipping)
+                {
+                  s->bad++;
+                }
+
+              printf("%d end frames %lu bad %lu gaps %lu lost %lu\n", i, s->frames, s->bad, s->gaps, s->lost);
+              close(s->fd);
+              pfd[i].fd = -1;
+              open_n--;
+              continue;
+            }
+
+          s->len += got;
+          tp_scan(i, s);
+        }
+    }
+
+  return 0;
+}
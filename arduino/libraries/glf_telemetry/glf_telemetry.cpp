@@ -0,0 +1,165 @@
+/* glf_telemetry library               17 Oct 2026 agent
+
+   Framed binary telemetry -- see glf_telemetry.h for the frame and record formats.
+
+*/
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include "WProgram.h"
+#endif
+
+#include "glf_telemetry.h"
+
+
+extern "C"    /* begin C-only code */
+{
+
+#define TELEM_TX_MASK (TELEM_TX_SIZE - 1)
+
+  static unsigned char telem_ring[TELEM_TX_SIZE];
+  static unsigned char telem_head = 0;      /* next byte to be written */
+  static unsigned char telem_tail = 0;      /* next byte to be sent */
+  static unsigned char telem_used = 0;
+  static unsigned char telem_seq = 0;
+  static unsigned int telem_drops = 0;
+
+  static int (*telem_room)(void) = NULL;
+  static void (*telem_put)(unsigned char) = NULL;
+
+
+  void telem_begin(int (*room)(void), void (*putbyte)(unsigned char))
+  {
+    telem_room = room;
+    telem_put = putbyte;
+
+    telem_head = 0;
+    telem_tail = 0;
+    telem_used = 0;
+    telem_seq = 0;
+    telem_drops = 0;
+  }
+
+
+  /* COBS encode len bytes from in to out, adding the 0x00 delimiter -- returns encoded length,
+     which is at most len + 2 for len < 254. */
+
+  static unsigned char telem_cobs0(const unsigned char *in, unsigned char len, unsigned char *out)
+  {
+    unsigned char code = 1;      /* length of current block, plus one */
+    unsigned char codepos = 0;   /* where the current block's length byte goes */
+    unsigned char n = 1;
+    unsigned char i;
+
+    for (i=0; i<len; i++)
+      {
+        if (in[i] == 0)
+          {
+            /* a zero ends the block -- it is implied by the block length rather than sent */
+            out[codepos] = code;
+            codepos = n++;
+            code = 1;
+          }
+        else
+          {
+            out[n++] = in[i];
+            code++;
+
+            if (code == 0xFF)      /* longest possible block -- no implied zero after it */
+              {
+                out[codepos] = code;
+                codepos = n++;
+                code = 1;
+              }
+          }
+      }
+
+    out[codepos] = code;
+    out[n++] = 0;
+
+    return n;
+  }
+
+
+  char telem_send(unsigned char type, const void *body, unsigned char len)
+  {
+    unsigned char raw[TELEM_MAX_BODY + 3];
+    unsigned char frame[TELEM_MAX_BODY + 5];
+    unsigned char sum;
+    unsigned char n;
+    unsigned char i;
+
+    if (len > TELEM_MAX_BODY)
+      {
+        telem_drops++;
+        return 0;
+      }
+
+    raw[0] = type;
+    raw[1] = telem_seq;
+    sum = type + telem_seq;
+
+    for (i=0; i<len; i++)
+      {
+        raw[i+2] = ((const unsigned char *)body)[i];
+        sum += raw[i+2];
+      }
+
+    raw[len+2] = sum;
+
+    n = telem_cobs0(raw, len + 3, frame);
+
+    if ((TELEM_TX_SIZE - telem_used) < n)
+      {
+        /* Never send part of a frame -- the host would lose the next one too while resynchronising. */
+        telem_drops++;
+        return 0;
+      }
+
+    for (i=0; i<n; i++)
+      {
+        telem_ring[telem_head] = frame[i];
+        telem_head = (telem_head + 1) & TELEM_TX_MASK;
+      }
+
+    telem_used += n;
+    telem_seq++;
+
+    return 1;
+  }
+
+
+  void telem_service(void)
+  {
+    int room;
+
+    if ((!telem_used) || (!telem_put))
+      {
+        return;
+      }
+
+    room = telem_room ? telem_room() : telem_used;
+
+    while ((room > 0) && telem_used)
+      {
+        telem_put(telem_ring[telem_tail]);
+        telem_tail = (telem_tail + 1) & TELEM_TX_MASK;
+        telem_used--;
+        room--;
+      }
+  }
+
+
+  unsigned char telem_pending(void)
+  {
+    return telem_used;
+  }
+
+
+  unsigned int telem_dropped(void)
+  {
+    return telem_drops;
+  }
+
+}             /* end C-only code */
@@ -0,0 +1,136 @@
+/* glf_telemetry library               17 Oct 2026 agent
+
+   Framed binary telemetry for glf_scheduler projects -- replaces free-form Serial.print() output with
+   fixed-layout records which a host program can pick out of the byte stream without guessing, at
+   whatever baud rate the link will carry.
+
+   Each record is assembled as
+
+      type  seq  <body>  sum
+
+   where seq counts records queued (so the host can spot frames lost on the link -- frames dropped for
+   lack of TX room are counted by telem_dropped() instead) and sum is the 8-bit sum of type, seq and
+   body.  The record is then COBS encoded (Consistent Overhead Byte Stuffing -- at most one extra byte
+   for bodies this short) and followed by a single 0x00, which therefore only ever appears as a frame
+   delimiter.  A host resynchronises on the next 0x00 after any error -- extras/host/telem_parse does
+   this for any number of devices at once, decoding the standard records below.
+
+   Record bodies are little-endian and packed (AVR layout, no padding).  Standard record types and
+   their bodies are given below; types from 0x80 up are free for the application.
+
+   Output is non-blocking: telem_send() encodes the whole frame into a RAM ring or, if there is not
+   room for all of it, drops the frame and counts the drop.  telem_service(), called once per pass of
+   the user event loop, moves only as many bytes to the output as it says it can take without
+   waiting.  Neither function may be called from an interrupt.
+
+*/
+
+#ifndef __GLF_TELEMETRY_H__
+#define __GLF_TELEMETRY_H__ 1
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include "WProgram.h"
+#endif
+
+
+#define TELEM_TX_SIZE   64      /* bytes in TX ring -- power of 2, at most 128 */
+#define TELEM_MAX_BODY  32      /* longest record body accepted by telem_send() */
+
+
+/* Standard record types */
+
+#define TELEM_TEXT         0x01    /* body: ASCII text, no terminator (banner, notes) */
+#define TELEM_DIGIT        0x02    /* body: telem_digit */
+#define TELEM_EOL          0x03    /* body: unsigned long ms -- dial held past timeout, end of number */
+#define TELEM_DIAL_STATS   0x04    /* body: telem_dial_stats */
+#define TELEM_SCHED_STATS  0x05    /* body: telem_sched_stats */
+#define TELEM_TRACE        0x06    /* body: unsigned long base, unsigned char dropped, then trace records
+                                      exactly as returned by sched_trace_read() */
+#define TELEM_LATENCY      0x07    /* body: telem_latency */
+#define TELEM_BOUNCE       0x08    /* body: telem_bounce */
+#define TELEM_USAGE        0x09    /* body: telem_usage */
+
+#define TELEM_LAT_BUCKETS     10
+#define TELEM_BOUNCE_BUCKETS   8
+
+typedef struct
+{
+  unsigned long ms;             /* millis() when the digit was decoded */
+  unsigned char digit;          /* 0 to 9 */
+  unsigned char pulses;         /* pulses actually counted (10 for "0", more if the dial misbehaved) */
+}
+telem_digit;
+
+typedef struct
+{
+  unsigned long ms;
+  unsigned int digits;          /* digits decoded */
+  unsigned int numbers;         /* dial timeouts (end of number) */
+  unsigned int overruns;        /* dialing periods with more than 10 pulses */
+  unsigned int empties;         /* dialing periods with no pulses at all */
+}
+telem_dial_stats;
+
+typedef struct
+{
+  unsigned long ms;
+  unsigned long ticks;          /* as sched_stats */
+  unsigned long isr_total;
+  unsigned char isr_last;
+  unsigned char isr_max;
+  unsigned int dropped;         /* telemetry frames dropped for lack of TX room */
+  unsigned long deferred;       /* as sched_stats */
+  unsigned char work_max;
+  unsigned char lag_max;
+}
+telem_sched_stats;
+
+typedef struct
+{
+  unsigned char stage;          /* application defined -- which step of the signal path */
+  unsigned int bucket[TELEM_LAT_BUCKETS];   /* event counts: bucket 0 under 1 ms, bucket b from 2^(b-1) ms
+                                               up to 2^b ms, last bucket everything longer */
+}
+telem_latency;
+
+typedef struct
+{
+  unsigned char pin;            /* application defined -- which contact */
+  unsigned int transitions;     /* debounced transitions since the last record */
+  unsigned char worst;          /* most bounces on any one of them */
+  unsigned int bucket[TELEM_BOUNCE_BUCKETS];   /* transitions by bounces: bucket 0 none, bucket b from
+                                                  2^(b-1) up to 2^b - 1, last bucket everything more */
+}
+telem_bounce;
+
+typedef struct
+{
+  unsigned long ms;
+  unsigned long pulses;         /* dial pulses since power up */
+  unsigned long dialings;       /* dialing periods begun since power up */
+}
+telem_usage;
+
+
+extern "C"    /* begin C-only code */
+{
+
+  void telem_begin(int (*room)(void), void (*putbyte)(unsigned char));
+  /* Set up the output: room() returns the number of bytes putbyte() can take right now without
+     blocking -- e.g. Serial.availableForWrite(). */
+
+  char telem_send(unsigned char type, const void *body, unsigned char len);
+  /* Queue one record.  Returns HIGH if queued, LOW if dropped (no room, or body longer than
+     TELEM_MAX_BODY). */
+
+  void telem_service(void);   /* move queued bytes to the output -- call once per pass of the event loop */
+
+  unsigned char telem_pending(void);   /* bytes still waiting in the TX ring */
+
+  unsigned int telem_dropped(void);    /* frames dropped since telem_begin() */
+
+}             /* end C-only code */
+
+#endif   /* ... of __GLF_TELEMETRY_H__ */